@@ -0,0 +1,123 @@
+/*
+    Project FreeAX25_Runtime
+    Copyright (C) 2015  tania@df9ry.de
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "BroadcastChannel.h"
+#include "Environment.h"
+
+#include <atomic>
+#include <exception>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+namespace FreeAX25 {
+	namespace Runtime {
+
+		BroadcastChannel::BroadcastChannel():
+			m_subscribers{make_shared<const SubscriberList>()}
+		{
+		}
+
+		BroadcastChannel::~BroadcastChannel()
+		{
+		}
+
+		shared_ptr<const BroadcastChannel::SubscriberList>
+		BroadcastChannel::snapshot() const
+		{
+			return atomic_load(&m_subscribers);
+		}
+
+		BroadcastChannel::Handle BroadcastChannel::subscribe(
+				ReceiveFunction receive,
+				ReceiveFrameFunction receiveFrame)
+		{
+			lock_guard<mutex> lock(m_mutex);
+			shared_ptr<SubscriberList> list{make_shared<SubscriberList>(*snapshot())};
+			Handle handle = m_nextHandle++;
+			list->push_back(Subscriber{handle, move(receive), move(receiveFrame)});
+			atomic_store(&m_subscribers, shared_ptr<const SubscriberList>{move(list)});
+			return handle;
+		}
+
+		bool BroadcastChannel::unsubscribe(Handle handle)
+		{
+			lock_guard<mutex> lock(m_mutex);
+			shared_ptr<const SubscriberList> current{snapshot()};
+			shared_ptr<SubscriberList> list{make_shared<SubscriberList>()};
+			list->reserve(current->size());
+			for (const Subscriber& s : *current)
+				if (s.handle != handle) list->push_back(s);
+			if (list->size() == current->size()) return false;
+			atomic_store(&m_subscribers, shared_ptr<const SubscriberList>{move(list)});
+			return true;
+		}
+
+		void BroadcastChannel::publish(
+				const shared_ptr<const JsonX::Object>& message,
+				MessagePriority priority)
+		{
+			if (!message) throw invalid_argument("No message");
+			shared_ptr<const SubscriberList> list{snapshot()};
+			for (const Subscriber& s : *list) {
+				if (!s.receive) continue;
+				try {
+					s.receive(message, priority);
+				}
+				catch (const exception& ex) {
+					env().logError(
+							string("Broadcast subscriber with exception: ") +
+							ex.what());
+				}
+				catch (...) {
+					env().logError(
+							string("Broadcast subscriber with unknown exception"));
+				}
+			} // end for //
+		}
+
+		void BroadcastChannel::publishFrame(
+				const Frame& frame,
+				MessagePriority priority)
+		{
+			shared_ptr<const SubscriberList> list{snapshot()};
+			for (const Subscriber& s : *list) {
+				if (!s.receiveFrame) continue;
+				try {
+					s.receiveFrame(frame, priority);
+				}
+				catch (const exception& ex) {
+					env().logError(
+							string("Broadcast subscriber with exception: ") +
+							ex.what());
+				}
+				catch (...) {
+					env().logError(
+							string("Broadcast subscriber with unknown exception"));
+				}
+			} // end for //
+		}
+
+		size_t BroadcastChannel::size() const
+		{
+			return snapshot()->size();
+		}
+
+	} /* end namespace Runtime */
+} /* end namespace FreeAX25 */
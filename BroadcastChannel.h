@@ -0,0 +1,181 @@
+/*
+    Project FreeAX25_Runtime
+    Copyright (C) 2015  tania@df9ry.de
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file */
+
+#ifndef FREEAX25_RUNTIME_BROADCASTCHANNEL_H_
+#define FREEAX25_RUNTIME_BROADCASTCHANNEL_H_
+
+#include "ChannelProxy.h"
+#include "Frame.h"
+
+#include <JsonXValue.h>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace FreeAX25 {
+	namespace Runtime {
+
+		/**
+		 * Channel with one publisher and any number of subscribers. Every
+		 * published message is delivered to all subscribers as the same
+		 * immutable object, so nothing is copied per subscriber. Frames
+		 * share their buffer anyway.
+		 *
+		 * The subscriber list is copy on write: publish() only takes a
+		 * snapshot of the current list and never waits for subscribe() or
+		 * unsubscribe(). A subscriber that was removed can still get a
+		 * message from a publish() that was already running.
+		 */
+		class BroadcastChannel {
+		public:
+			/**
+			 * Subscriber handle, to unsubscribe later.
+			 */
+			typedef uint64_t Handle;
+
+			/**
+			 * Function that receives published messages.
+			 */
+			typedef std::function<void(
+					const std::shared_ptr<const JsonX::Object>& message,
+					MessagePriority priority)> ReceiveFunction;
+
+			/**
+			 * Function that receives published frames.
+			 */
+			typedef std::function<void(
+					const Frame& frame,
+					MessagePriority priority)> ReceiveFrameFunction;
+
+			/**
+			 * Constructor.
+			 */
+			BroadcastChannel();
+
+			/**
+			 * You can not copy a BroadcastChannel.
+			 * @param other Not used.
+			 */
+			BroadcastChannel(const BroadcastChannel& other) = delete;
+
+			/**
+			 * You can not move a BroadcastChannel.
+			 * @param other Not used.
+			 */
+			BroadcastChannel(BroadcastChannel&& other) = delete;
+
+			/**
+			 * You can not assign a BroadcastChannel.
+			 * @param other Not used.
+			 * @return Not used.
+			 */
+			BroadcastChannel& operator=(const BroadcastChannel& other) = delete;
+
+			/**
+			 * You can not assign a BroadcastChannel.
+			 * @param other Not used.
+			 * @return Not used.
+			 */
+			BroadcastChannel& operator=(BroadcastChannel&& other) = delete;
+
+			/**
+			 * Destructor.
+			 */
+			~BroadcastChannel();
+
+			/**
+			 * Add a subscriber. Can be called from any thread.
+			 * @param receive Function for messages, may be empty.
+			 * @param receiveFrame Function for frames, may be empty.
+			 * @return Handle for unsubscribe().
+			 */
+			Handle subscribe(
+					ReceiveFunction receive,
+					ReceiveFrameFunction receiveFrame = nullptr);
+
+			/**
+			 * Remove a subscriber. Can be called from any thread, also from
+			 * within a receive function.
+			 * @param handle Handle from subscribe().
+			 * @return false if there was no such subscriber.
+			 */
+			bool unsubscribe(Handle handle);
+
+			/**
+			 * Publish a message to all subscribers. An exception of a
+			 * subscriber is logged and does not stop the delivery to the
+			 * other subscribers.
+			 * @param message Message to publish, must not be null.
+			 * @param priority Message priority.
+			 */
+			void publish(
+					const std::shared_ptr<const JsonX::Object>& message,
+					MessagePriority priority = MessagePriority::ROUTINE);
+
+			/**
+			 * Publish a message to all subscribers.
+			 * @param message Message to publish. It becomes immutable.
+			 * @param priority Message priority.
+			 */
+			void publish(
+					std::unique_ptr<JsonX::Object>&& message,
+					MessagePriority priority = MessagePriority::ROUTINE)
+			{
+				publish(std::shared_ptr<const JsonX::Object>{std::move(message)},
+						priority);
+			}
+
+			/**
+			 * Publish a frame to all subscribers.
+			 * @param frame Frame to publish.
+			 * @param priority Message priority.
+			 */
+			void publishFrame(
+					const Frame& frame,
+					MessagePriority priority = MessagePriority::ROUTINE);
+
+			/**
+			 * Get the number of subscribers.
+			 * @return Number of subscribers.
+			 */
+			size_t size() const;
+
+		private:
+			struct Subscriber {
+				Handle               handle;
+				ReceiveFunction      receive;
+				ReceiveFrameFunction receiveFrame;
+			};
+			typedef std::vector<Subscriber> SubscriberList;
+
+			std::shared_ptr<const SubscriberList> snapshot() const;
+
+			std::shared_ptr<const SubscriberList> m_subscribers;
+			std::mutex                            m_mutex{}; // Writers only
+			Handle                                m_nextHandle{1};
+		};
+
+	} /* end namespace Runtime */
+} /* end namespace FreeAX25 */
+
+#endif /* FREEAX25_RUNTIME_BROADCASTCHANNEL_H_ */
@@ -19,18 +19,144 @@
 #include "Channel.h"
 #include "Environment.h"
 
+#include <chrono>
+#include <deque>
 #include <stdexcept>
 #include <string>
 
 using namespace std;
+using namespace std::chrono;
 
 namespace FreeAX25 {
 	namespace Runtime {
 
+		// Give back to the pool what the handler did not take over:
+		void Channel::recycle(std::unique_ptr<JsonX::Object>& object)
+		{
+			if (object) env().messagePool.release(move(object));
+		}
+
+		// Test for the reserved control request {"op":"stats"}:
+		static inline bool isStatsRequest(const std::unique_ptr<JsonX::Object>& request)
+		{
+			if (!request) return false;
+			const JsonX::String* op = dynamic_cast<const JsonX::String*>(request->get("op"));
+			return op && (op->getValue() == "stats");
+		}
+
+		// Delivery that waits for the outermost trampolined delivery on this thread:
+		struct PendingHop {
+			ChannelProxy    target;
+			Envelope        envelope;
+			MessagePriority priority;
+		};
+
+		static thread_local size_t                 t_depth{0};
+		static thread_local std::deque<PendingHop> t_pending{};
+
+		Channel::Channel(std::shared_ptr<SessionBase> session):
+			m_session{session}, m_local{ChannelProxy(this)}
+		{
+			if (ChannelStats::enabledByDefault()) m_stats.reset(new ChannelStats());
+		}
+
+		Channel::~Channel()
+		{
+			releaseHandle();
+		}
+
+		ChannelHandle Channel::getHandle() const
+		{
+			// Most channels never hand out a handle, so do not take the
+			// table lock for them:
+			std::call_once(m_handleOnce, [this]() {
+				m_handle = env().channelHandles.acquire(const_cast<Channel*>(this));
+			});
+			return m_handle;
+		}
+
+		void Channel::releaseHandle()
+		{
+			// No handle after a reset, wait for one that is just acquired:
+			std::call_once(m_handleOnce, []() {});
+			if (!m_handle) return;
+			env().channelHandles.release(m_handle);
+			m_handle = ChannelHandle();
+		}
+
+		void Channel::enableStats(bool enable)
+		{
+			if (enable) {
+				if (!m_stats) m_stats.reset(new ChannelStats());
+			}
+			else {
+				m_stats.reset();
+			}
+		}
+
+		void Channel::connect(ChannelProxy target)
+		{
+			connect(target, env().messagePool.acquire());
+		}
+
+		void Channel::open()
+		{
+			open(env().messagePool.acquire());
+		}
+
+		void Channel::close()
+		{
+			close(env().messagePool.acquire());
+		}
+
 		void Channel::connect(ChannelProxy target, std::unique_ptr<JsonX::Object>&& parameter)
 		{
 			if (m_remote) throw runtime_error("Already connected");
 			m_remote = target.connect(getLocalProxy(), move(parameter));
+			initCredits();
+		}
+
+		void Channel::connect(ChannelProxy target, std::unique_ptr<JsonX::Object>&& parameter,
+				const UniquePointerDict<Setting>& settings)
+		{
+			string names{Setting::asStringValue(settings, "interceptors")};
+			for (auto& interceptor : env().interceptors.createList(names))
+				addInterceptor(move(interceptor));
+			connect(target, move(parameter));
+		}
+
+		void Channel::addInterceptor(std::unique_ptr<Interceptor>&& interceptor)
+		{
+			if (!interceptor) throw invalid_argument("No interceptor");
+			m_interceptors.push_back(move(interceptor));
+		}
+
+		// Run the interceptors before the message is queued. Returns false
+		// if one of them dropped it.
+		bool Channel::intercept(std::unique_ptr<JsonX::Object>& message, MessagePriority& priority)
+		{
+			if (m_interceptors.empty()) return true;
+			if (!message) throw invalid_argument("No message");
+			for (auto& interceptor : m_interceptors) {
+				if (!interceptor->onSend(message, priority)) {
+					recycle(message);
+					return false;
+				}
+			} // end for //
+			if (!message) throw invalid_argument("Interceptor removed the message");
+			return true;
+		}
+
+		// Same as intercept() for a Frame. The interceptors work on a copy,
+		// frame is pointed to it.
+		bool Channel::interceptFrame(const Frame*& frame, Frame& copy, MessagePriority& priority)
+		{
+			if (m_interceptors.empty()) return true;
+			copy = *frame;
+			frame = &copy;
+			for (auto& interceptor : m_interceptors)
+				if (!interceptor->onSendFrame(copy, priority)) return false;
+			return true;
 		}
 
 		void Channel::open(std::unique_ptr<JsonX::Object>&& parameter)
@@ -44,12 +170,154 @@ namespace FreeAX25 {
 			if (!m_remote) throw runtime_error("Not connected");
 			m_remote.close(move(parameter));
 			m_remote.reset();
+			m_flowControlled = false;
 		}
 
 		void Channel::send(std::unique_ptr<JsonX::Object>&& message, MessagePriority priority)
 		{
 			if (!m_remote) throw runtime_error("Not connected");
-			m_remote.send(move(message), priority);
+			if (!takeCredits(1)) throw runtime_error("No credit");
+			try {
+				if (!intercept(message, priority)) {
+					returnCredits(1);
+					return;
+				}
+				m_remote.send(move(message), priority);
+			}
+			catch (...) {
+				returnCredits(1);
+				throw;
+			}
+			if (m_stats) m_stats->countSent(priority);
+		}
+
+		SendResult Channel::trySend(std::unique_ptr<JsonX::Object>&& message, MessagePriority priority)
+		{
+			if (!m_remote) return SendResult::NOT_CONNECTED;
+			if (!takeCredits(1)) return SendResult::WOULD_BLOCK;
+			SendResult result;
+			try {
+				if (!intercept(message, priority)) {
+					returnCredits(1);
+					return SendResult::OK;
+				}
+				result = m_remote.trySend(move(message), priority);
+			}
+			catch (...) {
+				returnCredits(1);
+				throw;
+			}
+			if (result != SendResult::OK)
+				returnCredits(1);
+			else if (m_stats)
+				m_stats->countSent(priority);
+			return result;
+		}
+
+		void Channel::sendBatch(std::vector<std::unique_ptr<JsonX::Object>>&& messages, MessagePriority priority)
+		{
+			if (!m_remote) throw runtime_error("Not connected");
+			size_t n = messages.size();
+			if (!takeCredits(n)) throw runtime_error("No credit");
+			if (m_interceptors.empty()) {
+				try {
+					m_remote.sendBatch(move(messages), priority);
+				}
+				catch (...) {
+					// What is left in messages was not sent:
+					returnCredits(messages.size());
+					throw;
+				}
+				if (m_stats)
+					for (size_t i = 0; i < n; ++i) m_stats->countSent(priority);
+				return;
+			}
+			// Intercept the batch and split it by the resulting priority:
+			std::vector<std::unique_ptr<JsonX::Object>> lanes[2];
+			try {
+				for (auto& message: messages) {
+					MessagePriority p = priority;
+					if (intercept(message, p))
+						lanes[(p == MessagePriority::PRIORITY) ? 0 : 1].push_back(move(message));
+				} // end for //
+			}
+			catch (...) {
+				// The batch is lost:
+				messages.clear();
+				returnCredits(n);
+				throw;
+			}
+			messages.clear();
+			returnCredits(n - lanes[0].size() - lanes[1].size());
+			// PRIORITY messages first:
+			for (int l = 0; l < 2; ++l) {
+				if (lanes[l].empty()) continue;
+				MessagePriority p = (l == 0) ? MessagePriority::PRIORITY : MessagePriority::ROUTINE;
+				size_t count = lanes[l].size();
+				try {
+					m_remote.sendBatch(move(lanes[l]), p);
+				}
+				catch (...) {
+					// Leave what was not sent with the caller:
+					for (int r = l; r < 2; ++r)
+						for (auto& message: lanes[r]) messages.push_back(move(message));
+					returnCredits(messages.size());
+					throw;
+				}
+				if (m_stats)
+					for (size_t i = 0; i < count; ++i) m_stats->countSent(p);
+			} // end for //
+		}
+
+		void Channel::sendFrame(const Frame& frame, MessagePriority priority)
+		{
+			if (!m_remote) throw runtime_error("Not connected");
+			if (!takeCredits(1)) throw runtime_error("No credit");
+			const Frame* out = &frame;
+			Frame copy{};
+			try {
+				if (!interceptFrame(out, copy, priority)) {
+					returnCredits(1);
+					return;
+				}
+				m_remote.sendFrame(*out, priority);
+			}
+			catch (...) {
+				returnCredits(1);
+				throw;
+			}
+			if (m_stats) m_stats->countSent(priority, out->size());
+		}
+
+		SendResult Channel::trySendFrame(const Frame& frame, MessagePriority priority)
+		{
+			if (!m_remote) return SendResult::NOT_CONNECTED;
+			if (!takeCredits(1)) return SendResult::WOULD_BLOCK;
+			const Frame* out = &frame;
+			Frame copy{};
+			SendResult result;
+			try {
+				if (!interceptFrame(out, copy, priority)) {
+					returnCredits(1);
+					return SendResult::OK;
+				}
+				result = m_remote.trySendFrame(*out, priority);
+			}
+			catch (...) {
+				returnCredits(1);
+				throw;
+			}
+			if (result != SendResult::OK)
+				returnCredits(1);
+			else if (m_stats)
+				m_stats->countSent(priority, out->size());
+			return result;
+		}
+
+		void Channel::grant(size_t credits)
+		{
+			if (!m_remote) throw runtime_error("Not connected");
+			m_remote.grant(credits);
 		}
 
 		std::unique_ptr<JsonX::Object> Channel::ctrl(std::unique_ptr<JsonX::Object>&& request)
@@ -58,34 +326,403 @@ namespace FreeAX25 {
 			return m_remote.ctrl(move(request));
 		}
 
+		void Channel::ctrlAsync(std::unique_ptr<JsonX::Object>&& request,
+				CtrlCompletion completion,
+				const std::chrono::steady_clock::duration& timeout)
+		{
+			if (!m_remote) throw runtime_error("Not connected");
+			m_remote.ctrlAsync(move(request), move(completion), timeout);
+		}
+
+		std::future<std::unique_ptr<JsonX::Object>> Channel::ctrlFuture(
+				std::unique_ptr<JsonX::Object>&& request,
+				const std::chrono::steady_clock::duration& timeout)
+		{
+			if (!m_remote) throw runtime_error("Not connected");
+			return m_remote.ctrlFuture(move(request), timeout);
+		}
+
 		ChannelProxy Channel::onRemoteConnect(ChannelProxy backlink, std::unique_ptr<JsonX::Object>&& parameter)
 		{
-			if (!connectFunction) throw runtime_error("Connect not supported");
-			return connectFunction(backlink, move(parameter));
+			ChannelProxy result{};
+			try {
+				if (m_dispatch) {
+					result = m_dispatch->connect(*this, backlink, move(parameter));
+				}
+				else {
+					if (!connectFunction) throw runtime_error("Connect not supported");
+					result = connectFunction(backlink, move(parameter));
+				}
+			}
+			catch (...) {
+				if (m_stats) m_stats->countError();
+				throw;
+			}
+			recycle(parameter);
+			return result;
 		}
 
 		void Channel::onRemoteOpen(std::unique_ptr<JsonX::Object>&& parameter)
 		{
-			if (!openFunction) throw runtime_error("Open not supported");
-			openFunction(move(parameter));
+			try {
+				if (m_dispatch) {
+					m_dispatch->open(*this, move(parameter));
+				}
+				else {
+					if (!openFunction) throw runtime_error("Open not supported");
+					openFunction(move(parameter));
+				}
+			}
+			catch (...) {
+				if (m_stats) m_stats->countError();
+				throw;
+			}
+			recycle(parameter);
 		}
 
 		void Channel::onRemoteClose(std::unique_ptr<JsonX::Object>&& parameter)
 		{
-			if (!closeFunction) throw runtime_error("Close not supported");
-			closeFunction(move(parameter));
+			try {
+				if (m_dispatch) {
+					m_dispatch->close(*this, move(parameter));
+				}
+				else {
+					if (!closeFunction) throw runtime_error("Close not supported");
+					closeFunction(move(parameter));
+				}
+			}
+			catch (...) {
+				if (m_stats) m_stats->countError();
+				throw;
+			}
+			recycle(parameter);
+		}
+
+		void Channel::enableQueue(size_t capacity)
+		{
+			if (m_mailbox) throw runtime_error("Already queued");
+			m_mailbox.reset(new Mailbox(capacity));
+		}
+
+		void Channel::enableRing(size_t capacity)
+		{
+			if (m_mailbox) throw runtime_error("Already queued");
+			m_mailbox.reset(new Mailbox(capacity, true));
+		}
+
+		bool Channel::wait(int timeout)
+		{
+			if (!m_mailbox) throw runtime_error("Not queued");
+			return m_mailbox->wait(timeout);
+		}
+
+		size_t Channel::poll(size_t max)
+		{
+			if (!m_mailbox) throw runtime_error("Not queued");
+			size_t n = 0;
+			Envelope envelope{};
+			MessagePriority priority;
+			while (((max == 0) || (n < max)) && m_mailbox->pop(envelope, priority)) {
+				switch (envelope.kind) {
+				case EnvelopeKind::MESSAGE:
+					++n;
+					deliver(move(envelope.message), priority);
+					break;
+				case EnvelopeKind::FRAME: {
+					++n;
+					Frame frame{move(envelope.frame)};
+					deliverFrame(frame, priority);
+					break;
+				}
+				default:
+					break;
+				} // end switch //
+			} // end while //
+			return n;
 		}
 
 		void Channel::onRemoteSend(std::unique_ptr<JsonX::Object>&& message, MessagePriority priority)
 		{
-			if (!receiveFunction) throw runtime_error("Receive not supported");
-			receiveFunction(move(message), priority);
+			if (!onRemoteTrySend(move(message), priority))
+				throw runtime_error("Queue full");
+		}
+
+		bool Channel::onRemoteTrySend(std::unique_ptr<JsonX::Object>&& message, MessagePriority priority)
+		{
+			if (!message) throw invalid_argument("No message");
+			if (m_mailbox) {
+				Envelope envelope{};
+				envelope.kind = EnvelopeKind::MESSAGE;
+				envelope.message = move(message);
+				if (!m_mailbox->push(envelope, priority)) {
+					message = move(envelope.message);
+					return false;
+				}
+				if (notifyFunction) notifyFunction();
+				return true;
+			}
+			if (m_trampoline) {
+				Envelope envelope{};
+				envelope.kind = EnvelopeKind::MESSAGE;
+				envelope.message = move(message);
+				trampoline(move(envelope), priority);
+				return true;
+			}
+			deliver(move(message), priority);
+			return true;
+		}
+
+		void Channel::onRemoteSendBatch(std::vector<std::unique_ptr<JsonX::Object>>&& messages, MessagePriority priority)
+		{
+			for (auto& message: messages)
+				if (!message) throw invalid_argument("No message");
+			if (m_mailbox) {
+				size_t n = 0;
+				Envelope envelope{};
+				envelope.kind = EnvelopeKind::MESSAGE;
+				for (; n < messages.size(); ++n) {
+					envelope.message = move(messages[n]);
+					if (!m_mailbox->push(envelope, priority)) {
+						messages[n] = move(envelope.message);
+						break;
+					}
+				} // end for //
+				if ((n > 0) && notifyFunction) notifyFunction();
+				if (n < messages.size()) {
+					// Leave the messages that did not fit with the caller:
+					messages.erase(messages.begin(), messages.begin() + n);
+					throw runtime_error("Queue full");
+				}
+				return;
+			}
+			if (m_trampoline) {
+				for (auto& message: messages) {
+					Envelope envelope{};
+					envelope.kind = EnvelopeKind::MESSAGE;
+					envelope.message = move(message);
+					trampoline(move(envelope), priority);
+				} // end for //
+				return;
+			}
+			deliverBatch(messages, priority);
+		}
+
+		void Channel::onRemoteSendFrame(const Frame& frame, MessagePriority priority)
+		{
+			if (!onRemoteTrySendFrame(frame, priority))
+				throw runtime_error("Queue full");
+		}
+
+		bool Channel::onRemoteTrySendFrame(const Frame& frame, MessagePriority priority)
+		{
+			if (m_mailbox) {
+				Envelope envelope{};
+				envelope.kind = EnvelopeKind::FRAME;
+				envelope.frame = frame;
+				if (!m_mailbox->push(envelope, priority)) return false;
+				if (notifyFunction) notifyFunction();
+				return true;
+			}
+			if (m_trampoline) {
+				Envelope envelope{};
+				envelope.kind = EnvelopeKind::FRAME;
+				envelope.frame = frame;
+				trampoline(move(envelope), priority);
+				return true;
+			}
+			deliverFrame(frame, priority);
+			return true;
+		}
+
+		void Channel::trampoline(Envelope&& envelope, MessagePriority priority)
+		{
+			if (t_depth > 0) {
+				// Inside a delivery on this thread, do it later:
+				t_pending.push_back(PendingHop{m_local, move(envelope), priority});
+				return;
+			}
+			++t_depth;
+			try {
+				deliverEnvelope(envelope, priority);
+			}
+			catch (...) {
+				drainPending();
+				--t_depth;
+				throw;
+			}
+			drainPending();
+			--t_depth;
+		}
+
+		void Channel::deliverEnvelope(Envelope& envelope, MessagePriority priority)
+		{
+			switch (envelope.kind) {
+			case EnvelopeKind::MESSAGE:
+				deliver(move(envelope.message), priority);
+				break;
+			case EnvelopeKind::FRAME:
+				deliverFrame(envelope.frame, priority);
+				break;
+			default:
+				break;
+			} // end switch //
+		}
+
+		void Channel::drainPending()
+		{
+			while (!t_pending.empty()) {
+				PendingHop hop{move(t_pending.front())};
+				t_pending.pop_front();
+				try {
+					Channel* channel = hop.target.m_channel;
+					if (!channel) throw runtime_error("Connection closed");
+					channel->deliverEnvelope(hop.envelope, hop.priority);
+				}
+				catch (const exception& ex) {
+					env().logError(
+							string("Trampolined delivery with exception: ") +
+							ex.what());
+				}
+				catch (...) {
+					env().logError(
+							string("Trampolined delivery with unknown exception"));
+				}
+			} // end while //
+		}
+
+		void Channel::deliver(std::unique_ptr<JsonX::Object>&& message, MessagePriority priority)
+		{
+			deliverTo([this](std::unique_ptr<JsonX::Object>&& message, MessagePriority priority) {
+				if (m_dispatch) {
+					m_dispatch->receive(*this, move(message), priority);
+				}
+				else {
+					if (!receiveFunction) throw runtime_error("Receive not supported");
+					receiveFunction(move(message), priority);
+				}
+			}, move(message), priority);
+		}
+
+		void Channel::deliverBatch(std::vector<std::unique_ptr<JsonX::Object>>& messages, MessagePriority priority)
+		{
+			// Typed channels and channels without a batch handler take
+			// the messages one by one:
+			if (m_dispatch || !receiveBatchFunction) {
+				for (auto& message: messages)
+					deliver(move(message), priority);
+				return;
+			}
+			size_t n = messages.size();
+			std::chrono::steady_clock::time_point start{};
+			if (m_stats) start = std::chrono::steady_clock::now();
+			try {
+				receiveBatchFunction(move(messages), priority);
+			}
+			catch (...) {
+				if (m_stats) m_stats->countError();
+				throw;
+			}
+			if (m_stats && (n > 0)) {
+				// Share the handler time evenly between the messages:
+				uint64_t ns = elapsed(start) / n;
+				for (size_t i = 0; i < n; ++i)
+					m_stats->countReceived(priority, 0, ns);
+			}
+			// The handler may have kept the vector or some of its messages:
+			for (auto& message: messages) recycle(message);
+		}
+
+		void Channel::deliverFrame(const Frame& frame, MessagePriority priority)
+		{
+			deliverFrameTo([this](const Frame& frame, MessagePriority priority) {
+				if (m_dispatch) {
+					m_dispatch->receiveFrame(*this, frame, priority);
+				}
+				else {
+					if (!receiveFrameFunction) throw runtime_error("Receive frame not supported");
+					receiveFrameFunction(frame, priority);
+				}
+			}, frame, priority);
+		}
+
+		void Channel::onRemoteGrant(size_t credits)
+		{
+			int64_t available = m_credits.fetch_add(credits) + credits;
+			if (creditFunction) creditFunction((available > 0) ? available : 0);
+		}
+
+		void Channel::initCredits()
+		{
+			size_t window = m_remote.creditWindow();
+			m_credits.store(window);
+			m_flowControlled = (window > 0);
+		}
+
+		bool Channel::takeCredits(size_t n)
+		{
+			if (!m_flowControlled) return true;
+			int64_t credits = m_credits.load(memory_order_relaxed);
+			do {
+				if (credits < (int64_t)n) return false;
+			} while (!m_credits.compare_exchange_weak(credits, credits - n));
+			return true;
+		}
+
+		void Channel::returnCredits(size_t n)
+		{
+			if (m_flowControlled) m_credits.fetch_add(n);
 		}
 
 		std::unique_ptr<JsonX::Object> Channel::onRemoteCtrl(std::unique_ptr<JsonX::Object>&& request)
 		{
-			if (!ctrlFunction) throw runtime_error("Control not supported");
-			return ctrlFunction(move(request));
+			if (isStatsRequest(request)) {
+				recycle(request);
+				if (m_stats) return m_stats->toJson();
+				std::unique_ptr<JsonX::Object> response{JsonX::Object::make()};
+				response->set("enabled", JsonX::Bool::make(false));
+				return response;
+			}
+			std::unique_ptr<JsonX::Object> response{};
+			try {
+				if (m_dispatch) {
+					response = m_dispatch->ctrl(*this, move(request));
+				}
+				else {
+					if (!ctrlFunction) throw runtime_error("Control not supported");
+					response = ctrlFunction(move(request));
+				}
+			}
+			catch (...) {
+				if (m_stats) m_stats->countError();
+				throw;
+			}
+			recycle(request);
+			return response;
+		}
+
+		void Channel::onRemoteCtrlAsync(std::unique_ptr<JsonX::Object>&& request, CtrlReply reply)
+		{
+			if (!ctrlAsyncFunction || isStatsRequest(request)) {
+				// Answer right away:
+				std::unique_ptr<JsonX::Object> response{};
+				try {
+					response = onRemoteCtrl(move(request));
+				}
+				catch (...) {
+					reply.fail(current_exception());
+					return;
+				}
+				reply.complete(move(response));
+				return;
+			}
+			try {
+				ctrlAsyncFunction(move(request), reply);
+			}
+			catch (...) {
+				if (m_stats) m_stats->countError();
+				reply.fail(current_exception());
+			}
+			recycle(request);
 		}
 
 	} /* end namespace Runtime */
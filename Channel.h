@@ -21,24 +21,82 @@
 #ifndef FREEAX25_RUNTIME_CHANNEL_H_
 #define FREEAX25_RUNTIME_CHANNEL_H_
 
+#include "ChannelHandle.h"
 #include "ChannelProxy.h"
+#include "ChannelStats.h"
+#include "CtrlReply.h"
+#include "Frame.h"
+#include "Interceptor.h"
+#include "Mailbox.h"
+#include "Setting.h"
 
 #include <JsonXValue.h>
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <future>
 #include <memory>
+#include <mutex>
+#include <stdexcept>
 #include <functional>
+#include <vector>
 
 namespace FreeAX25 {
 	namespace Runtime {
 
 		class SessionBase;
 
+		class Channel;
+
+		/**
+		 * Table of handler entry points for a Channel whose handler type is
+		 * known at compile time. The entries get the Channel, which knows
+		 * its handler. See TypedChannel.
+		 */
+		struct ChannelDispatch {
+			/**
+			 * Handle a connect request.
+			 */
+			ChannelProxy (*connect)(Channel& channel, ChannelProxy backlink,
+					std::unique_ptr<JsonX::Object>&& parameter);
+
+			/**
+			 * Handle an open request.
+			 */
+			void (*open)(Channel& channel, std::unique_ptr<JsonX::Object>&& parameter);
+
+			/**
+			 * Handle a close request.
+			 */
+			void (*close)(Channel& channel, std::unique_ptr<JsonX::Object>&& parameter);
+
+			/**
+			 * Handle a message.
+			 */
+			void (*receive)(Channel& channel, std::unique_ptr<JsonX::Object>&& message,
+					MessagePriority priority);
+
+			/**
+			 * Handle a binary frame.
+			 */
+			void (*receiveFrame)(Channel& channel, const Frame& frame,
+					MessagePriority priority);
+
+			/**
+			 * Handle a control request.
+			 */
+			std::unique_ptr<JsonX::Object> (*ctrl)(Channel& channel,
+					std::unique_ptr<JsonX::Object>&& request);
+		};
+
 		/**
 		 * A Channel is a device to send and receive to other peers.
 		 */
 		class Channel {
 			friend class SessionBase;
 			friend class ChannelProxy;
+			friend class ChannelHandle;
 
 		public:
 			/**
@@ -50,13 +108,12 @@ namespace FreeAX25 {
 			 * Constructor.
 			 * @param session Session this channel is attached to.
 			 */
-			Channel(std::shared_ptr<SessionBase> session):
-				m_session{session}, m_local{ChannelProxy(this)} {}
+			Channel(std::shared_ptr<SessionBase> session);
 
 			/**
 			 * Destructor.
 			 */
-			~Channel() {};
+			~Channel();
 
 			/**
 			 * Connect a channel.
@@ -71,10 +128,35 @@ namespace FreeAX25 {
 			 * Connect a channel.
 			 * @param target ChannelProxy to send the connect to.
 			 */
-			void connect(ChannelProxy target)
-			{
-				return connect(target, JsonX::Object::make());
-			}
+			void connect(ChannelProxy target);
+
+			/**
+			 * Connect a channel and attach the interceptors named in the
+			 * setting "interceptors" of the given settings first. The
+			 * setting is a comma separated list of names registered in
+			 * Environment::interceptors, in the order they shall run.
+			 * @param target ChannelProxy to send the connect to.
+			 * @param parameter Parameter for connect.
+			 * @param settings Settings, e.g. of the plugin instance.
+			 */
+			void connect(
+					ChannelProxy target,
+					std::unique_ptr<JsonX::Object>&& parameter,
+					const UniquePointerDict<Setting>& settings);
+
+			/**
+			 * Append an interceptor to the send path. It runs after all
+			 * interceptors that were added before. Call this before the
+			 * channel is used. Without interceptors the send path costs
+			 * nothing more than before.
+			 * @param interceptor The interceptor.
+			 */
+			void addInterceptor(std::unique_ptr<Interceptor>&& interceptor);
+
+			/**
+			 * Remove all interceptors.
+			 */
+			void clearInterceptors() { m_interceptors.clear(); }
 
 			/**
 			 * Open connection. This should be the first call after
@@ -87,9 +169,7 @@ namespace FreeAX25 {
 			 * Open connection. This should be the first call after
 			 * a connect.
 			 */
-			void open() {
-				open(JsonX::Object::make());
-			}
+			void open();
 
 			/**
 			 * Close connection. This should be the last call.
@@ -100,9 +180,7 @@ namespace FreeAX25 {
 			/**
 			 * Close connection. This should be the last call.
 			 */
-			void close() {
-				close(JsonX::Object::make());
-			}
+			void close();
 
 			/**
 			 * Send a message.
@@ -113,6 +191,83 @@ namespace FreeAX25 {
 					std::unique_ptr<JsonX::Object>&& message,
 					MessagePriority priority = MessagePriority::ROUTINE);
 
+			/**
+			 * Send a message without throwing, if there is no credit left
+			 * or the remote queue is full. Interceptors run before the
+			 * message is queued, so on a retry after a full queue they see
+			 * the message again. A message dropped by them counts as sent.
+			 * @param message Message to send. It is moved only on success.
+			 * @param priority Message priority.
+			 * @return Result of the send.
+			 */
+			SendResult trySend(
+					std::unique_ptr<JsonX::Object>&& message,
+					MessagePriority priority = MessagePriority::ROUTINE);
+
+			/**
+			 * Send a batch of messages with one call. With interceptors every
+			 * message keeps the priority its interceptors gave it, and
+			 * PRIORITY messages go first. If the remote queue gets full, the
+			 * messages not sent are left in messages.
+			 * @param messages Messages to send.
+			 * @param priority Message priority, before interceptors.
+			 */
+			void sendBatch(
+					std::vector<std::unique_ptr<JsonX::Object>>&& messages,
+					MessagePriority priority = MessagePriority::ROUTINE);
+
+			/**
+			 * Send a binary frame. The payload is shared, not copied.
+			 * @param frame Frame to send.
+			 * @param priority Message priority.
+			 */
+			void sendFrame(
+					const Frame& frame,
+					MessagePriority priority = MessagePriority::ROUTINE);
+
+			/**
+			 * Send a binary frame without throwing, if there is no credit
+			 * left or the remote queue is full.
+			 * @param frame Frame to send.
+			 * @param priority Message priority.
+			 * @return Result of the send.
+			 */
+			SendResult trySendFrame(
+					const Frame& frame,
+					MessagePriority priority = MessagePriority::ROUTINE);
+
+			/**
+			 * Set the credit window of this channel. A peer that connects
+			 * to this channel can send at most this number of messages,
+			 * until it gets more credits by grant(). Call this before the
+			 * channel is connected.
+			 * @param window Credit window, 0 to switch off flow control.
+			 */
+			void setCreditWindow(size_t window) { m_creditWindow = window; }
+
+			/**
+			 * Grant credits to the peer, usually after messages have been
+			 * processed.
+			 * @param credits Number of messages the peer may send more.
+			 */
+			void grant(size_t credits);
+
+			/**
+			 * Test if sending on this channel is flow controlled.
+			 * @return If sending on this channel is flow controlled.
+			 */
+			bool isFlowControlled() const { return m_flowControlled; }
+
+			/**
+			 * Get the number of messages that can be sent before running
+			 * out of credit.
+			 * @return Available credits. Only meaningful if flow controlled.
+			 */
+			size_t credits() const {
+				int64_t credits = m_credits.load(std::memory_order_relaxed);
+				return (credits > 0) ? (size_t)credits : 0;
+			}
+
 			/**
 			 * Send a request.
 			 * @param request Request to send.
@@ -121,6 +276,33 @@ namespace FreeAX25 {
 			std::unique_ptr<JsonX::Object> ctrl(
 					std::unique_ptr<JsonX::Object>&& request);
 
+			/**
+			 * Send a request without waiting for the response.
+			 * @param request Request to send.
+			 * @param completion Gets the response or the error. It runs on
+			 *                   the thread that answers, or on the timer
+			 *                   thread on timeout. A request that is
+			 *                   dropped without an answer fails with
+			 *                   "No answer".
+			 * @param timeout Time to wait for the response, zero for ever.
+			 */
+			void ctrlAsync(
+					std::unique_ptr<JsonX::Object>&& request,
+					CtrlCompletion completion,
+					const std::chrono::steady_clock::duration& timeout =
+							std::chrono::steady_clock::duration::zero());
+
+			/**
+			 * Send a request without waiting for the response.
+			 * @param request Request to send.
+			 * @param timeout Time to wait for the response, zero for ever.
+			 * @return Future for the response.
+			 */
+			std::future<std::unique_ptr<JsonX::Object>> ctrlFuture(
+					std::unique_ptr<JsonX::Object>&& request,
+					const std::chrono::steady_clock::duration& timeout =
+							std::chrono::steady_clock::duration::zero());
+
 			/**
 			 * Set this function to receive connect requests.
 			 */
@@ -145,18 +327,147 @@ namespace FreeAX25 {
 			std::function<void(std::unique_ptr<JsonX::Object>&&, MessagePriority)>
 				receiveFunction{};
 
+			/**
+			 * Set this function to receive batches of messages. If it is not
+			 * set, receiveFunction is called once per message instead.
+			 */
+			std::function<void(std::vector<std::unique_ptr<JsonX::Object>>&&, MessagePriority)>
+				receiveBatchFunction{};
+
+			/**
+			 * Set this function to receive binary frames.
+			 */
+			std::function<void(const Frame&, MessagePriority)>
+				receiveFrameFunction{};
+
 			/**
 			 * Set this function to receive control requests.
 			 */
 			std::function<std::unique_ptr<JsonX::Object>(std::unique_ptr<JsonX::Object>&&)>
 				ctrlFunction{};
 
+			/**
+			 * Set this function to receive asynchronous control requests.
+			 * Answer them later through the CtrlReply, from any thread. If
+			 * it is not set, ctrlFunction answers them right away.
+			 */
+			std::function<void(std::unique_ptr<JsonX::Object>&&, CtrlReply)>
+				ctrlAsyncFunction{};
+
+			/**
+			 * Set this function to be notified when the peer granted credits.
+			 * It gets the number of credits available now.
+			 */
+			std::function<void(size_t)>
+				creditFunction{};
+
+			/**
+			 * Set this function to be notified when a message or a frame was
+			 * queued in queued delivery mode. It runs on the sender's thread
+			 * and should do nothing more than waking up the receiver thread.
+			 */
+			std::function<void()>
+				notifyFunction{};
+
+			/**
+			 * Switch to queued delivery. Messages sent to this channel are
+			 * no longer passed to receiveFunction on the sender's thread but
+			 * put into a bounded lane for their MessagePriority. The receiver
+			 * thread then delivers them with poll(). Call this before the
+			 * channel is connected.
+			 * @param capacity Capacity of each lane.
+			 */
+			void enableQueue(size_t capacity);
+
+			/**
+			 * Switch to queued delivery over single producer rings. This is
+			 * the same as enableQueue(), but cheaper, because only one
+			 * thread is allowed to send to this channel. Enable it on both
+			 * ends of a connection to get a lock free transport between two
+			 * threads in both directions. Call this before the channel is
+			 * connected.
+			 * @param capacity Capacity of each lane.
+			 */
+			void enableRing(size_t capacity);
+
+			/**
+			 * Test if this channel is in queued delivery mode.
+			 * @return If this channel is in queued delivery mode.
+			 */
+			bool isQueued() const { return m_mailbox != nullptr; }
+
+			/**
+			 * Deliver queued messages to receiveFunction and queued frames
+			 * to receiveFrameFunction. PRIORITY messages
+			 * always go ahead of waiting ROUTINE messages. Must only be called
+			 * from the receiver thread.
+			 * @param max Maximal number of messages to deliver, 0 for all.
+			 * @return Number of messages delivered.
+			 */
+			size_t poll(size_t max = 0);
+
+			/**
+			 * Wait until something is queued for poll(). Must only be called
+			 * from the receiver thread.
+			 * @param timeout Timeout in milliseconds, -1 for infinite.
+			 * @return false on timeout.
+			 */
+			bool wait(int timeout = -1);
+
+			/**
+			 * Switch trampolined delivery on or off. Normally a message sent
+			 * to this channel is delivered right away, so a chain of
+			 * handlers that forward messages recurses on the stack. With
+			 * trampolined delivery a message that is sent to this channel
+			 * from inside another trampolined delivery on the same thread
+			 * is put into a per-thread pending queue instead. The outermost
+			 * delivery drains that queue once its handler returned, so the
+			 * stack depth stays constant and the hops are processed one
+			 * after the other. Exceptions of pending deliveries can not
+			 * reach their sender any more and are logged. Has no effect in
+			 * queued delivery mode.
+			 * @param enable If delivery shall be trampolined.
+			 */
+			void enableTrampoline(bool enable) { m_trampoline = enable; }
+
+			/**
+			 * Test if this channel uses trampolined delivery.
+			 * @return If this channel uses trampolined delivery.
+			 */
+			bool isTrampolined() const { return m_trampoline; }
+
+			/**
+			 * Switch statistics on or off. They are off by default, unless
+			 * the setting "channelStats" is true, because they time every
+			 * received message with two clock reads. Switching on starts
+			 * from zero. Call this while the channel is not in use. The
+			 * statistics are also returned for the control request
+			 * {"op":"stats"}, which is answered by the runtime and never
+			 * reaches ctrlFunction.
+			 * @param enable If statistics shall be kept.
+			 */
+			void enableStats(bool enable);
+
+			/**
+			 * Get the statistics of this channel.
+			 * @return Statistics or nullptr if switched off.
+			 */
+			const ChannelStats* stats() const { return m_stats.get(); }
+
 			/**
 			 * Get a proxy to local channel.
 			 * @return ChannelProxy.
 			 */
 			ChannelProxy getLocalProxy() { return m_local; }
 
+			/**
+			 * Get a non owning handle to the local channel. It is cheaper
+			 * to copy than a ChannelProxy, but becomes stale when the
+			 * channel is reset. The handle is allocated on the first call.
+			 * @return ChannelHandle, empty after reset.
+			 */
+			ChannelHandle getHandle() const;
+
 			/**
 			 * Get a proxy to remote channel.
 			 * @return ChannelProxy.
@@ -171,22 +482,141 @@ namespace FreeAX25 {
 				openFunction = nullptr;
 				closeFunction = nullptr;
 				receiveFunction = nullptr;
+				receiveBatchFunction = nullptr;
+				receiveFrameFunction = nullptr;
 				ctrlFunction = nullptr;
+				ctrlAsyncFunction = nullptr;
+				creditFunction = nullptr;
+				m_dispatch = nullptr;
+				notifyFunction = nullptr;
+				m_mailbox.reset();
+				m_interceptors.clear();
+				releaseHandle();
 				m_session.reset();
 				m_remote.reset();
 				m_local.reset(); // Might call delete!
 			}
 
+		protected:
+			/**
+			 * Bind a compile time handler. While bound, incoming requests go
+			 * to the dispatch table instead of the function objects.
+			 * @param dispatch Dispatch table of the handler type.
+			 */
+			void bind(const ChannelDispatch* dispatch) {
+				m_dispatch = dispatch;
+			}
+
+			/**
+			 * Test if a compile time handler is bound. reset() unbinds it.
+			 * @param dispatch Dispatch table of the handler type.
+			 * @return If this dispatch table is bound.
+			 */
+			bool isBound(const ChannelDispatch* dispatch) const {
+				return m_dispatch == dispatch;
+			}
+
+			/**
+			 * Test if a message sent to this channel is delivered right away
+			 * on the sender's thread.
+			 * @return If delivery is immediate.
+			 */
+			bool isImmediate() const { return !m_mailbox && !m_trampoline; }
+
+			/**
+			 * Deliver a message to a receive function with statistics and
+			 * recycling, like a message that came through a ChannelProxy.
+			 * @param receive Function that takes the message and priority.
+			 * @param message The message.
+			 * @param priority Message priority.
+			 */
+			template <typename Receive>
+			void deliverTo(Receive&& receive,
+					std::unique_ptr<JsonX::Object>&& message,
+					MessagePriority priority)
+			{
+				if (!message) throw std::invalid_argument("No message");
+				std::chrono::steady_clock::time_point start{};
+				if (m_stats) start = std::chrono::steady_clock::now();
+				try {
+					receive(std::move(message), priority);
+				}
+				catch (...) {
+					if (m_stats) m_stats->countError();
+					throw;
+				}
+				if (m_stats) m_stats->countReceived(priority, 0, elapsed(start));
+				recycle(message);
+			}
+
+			/**
+			 * Deliver a frame to a receive function with statistics, like a
+			 * frame that came through a ChannelProxy.
+			 * @param receive Function that takes the frame and priority.
+			 * @param frame The frame.
+			 * @param priority Message priority.
+			 */
+			template <typename Receive>
+			void deliverFrameTo(Receive&& receive, const Frame& frame,
+					MessagePriority priority)
+			{
+				std::chrono::steady_clock::time_point start{};
+				if (m_stats) start = std::chrono::steady_clock::now();
+				try {
+					receive(frame, priority);
+				}
+				catch (...) {
+					if (m_stats) m_stats->countError();
+					throw;
+				}
+				if (m_stats)
+					m_stats->countReceived(priority, frame.size(), elapsed(start));
+			}
+
 		private:
+			static uint64_t elapsed(const std::chrono::steady_clock::time_point& start) {
+				return std::chrono::duration_cast<std::chrono::nanoseconds>(
+						std::chrono::steady_clock::now() - start).count();
+			}
+
 			ChannelProxy onRemoteConnect(ChannelProxy backlink, std::unique_ptr<JsonX::Object>&& parameter);
 			void onRemoteOpen(std::unique_ptr<JsonX::Object>&& parameter);
 			void onRemoteClose(std::unique_ptr<JsonX::Object>&& parameter);
 			void onRemoteSend(std::unique_ptr<JsonX::Object>&& message, MessagePriority priority);
+			bool onRemoteTrySend(std::unique_ptr<JsonX::Object>&& message, MessagePriority priority);
+			void onRemoteSendBatch(std::vector<std::unique_ptr<JsonX::Object>>&& messages, MessagePriority priority);
+			void onRemoteSendFrame(const Frame& frame, MessagePriority priority);
+			bool onRemoteTrySendFrame(const Frame& frame, MessagePriority priority);
+			void onRemoteGrant(size_t credits);
+			void deliver(std::unique_ptr<JsonX::Object>&& message, MessagePriority priority);
+			void deliverFrame(const Frame& frame, MessagePriority priority);
+			void deliverBatch(std::vector<std::unique_ptr<JsonX::Object>>& messages, MessagePriority priority);
+			bool intercept(std::unique_ptr<JsonX::Object>& message, MessagePriority& priority);
+			bool interceptFrame(const Frame*& frame, Frame& copy, MessagePriority& priority);
+			void trampoline(Envelope&& envelope, MessagePriority priority);
+			void deliverEnvelope(Envelope& envelope, MessagePriority priority);
+			static void drainPending();
+			static void recycle(std::unique_ptr<JsonX::Object>& object);
+			void releaseHandle();
+			void initCredits();
+			bool takeCredits(size_t n);
+			void returnCredits(size_t n);
 			std::unique_ptr<JsonX::Object> onRemoteCtrl(std::unique_ptr<JsonX::Object>&& request);
+			void onRemoteCtrlAsync(std::unique_ptr<JsonX::Object>&& request, CtrlReply reply);
 
 			std::shared_ptr<SessionBase> m_session;
 			ChannelProxy                 m_local;
 			ChannelProxy                 m_remote{};
+			std::unique_ptr<Mailbox>     m_mailbox{};
+			size_t                       m_creditWindow{0};
+			bool                         m_flowControlled{false};
+			bool                         m_trampoline{false};
+			std::vector<std::unique_ptr<Interceptor>> m_interceptors{};
+			std::atomic<int64_t>         m_credits{0};
+			std::unique_ptr<ChannelStats> m_stats{};
+			const ChannelDispatch*       m_dispatch{nullptr};
+			mutable std::once_flag       m_handleOnce{};
+			mutable ChannelHandle        m_handle{};
 		};
 
 	} /* end namespace Runtime */
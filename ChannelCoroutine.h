@@ -0,0 +1,323 @@
+/*
+    Project FreeAX25_Runtime
+    Copyright (C) 2015  tania@df9ry.de
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file */
+
+#ifndef FREEAX25_RUNTIME_CHANNELCOROUTINE_H_
+#define FREEAX25_RUNTIME_CHANNELCOROUTINE_H_
+
+// The runtime itself is C++11. This layer is only there for C++20 users:
+#if defined(__cpp_impl_coroutine) && (__cplusplus >= 202002L)
+
+#include "Channel.h"
+#include "CtrlReply.h"
+#include "Environment.h"
+#include "Timer.h"
+#include "TimerManager.h"
+
+#include <JsonXValue.h>
+
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+
+namespace FreeAX25 {
+	namespace Runtime {
+
+		/**
+		 * Return type of a session coroutine. The coroutine starts right
+		 * away and runs until its first co_await. Nobody waits for it, an
+		 * exception that leaves it is logged.
+		 */
+		struct CoTask {
+			struct promise_type {
+				CoTask get_return_object() noexcept { return CoTask{}; }
+				std::suspend_never initial_suspend() noexcept { return {}; }
+				std::suspend_never final_suspend() noexcept { return {}; }
+				void return_void() noexcept {}
+				void unhandled_exception() noexcept {
+					try {
+						throw;
+					}
+					catch (const std::exception& ex) {
+						env().logError(
+								std::string("Coroutine with exception: ") +
+								ex.what());
+					}
+					catch (...) {
+						env().logError("Coroutine with unknown exception");
+					}
+				}
+			};
+		};
+
+		/**
+		 * Message received by CoChannel::receive().
+		 */
+		struct CoMessage {
+			/**
+			 * The message.
+			 */
+			std::unique_ptr<JsonX::Object> message{};
+
+			/**
+			 * Message priority.
+			 */
+			MessagePriority                priority{MessagePriority::ROUTINE};
+		};
+
+		/**
+		 * Coroutine view of a Channel. It takes over the receiveFunction of
+		 * the channel and keeps messages until a coroutine awaits them.
+		 * A waiting coroutine is resumed through the executor of the
+		 * CoChannel, so neither the sender nor the thread that answered
+		 * a request runs it. By default that is the timer worker pool.
+		 * Without "timerWorkers" and without an executor of your own it is
+		 * resumed inline instead: by the thread that sent the message,
+		 * by the thread that answered the request, or by the timer thread
+		 * on a timeout. It then holds up that thread until its next
+		 * co_await. The CoChannel must live as long as a coroutine waits
+		 * on it. Only one coroutine can receive at a time.
+		 */
+		class CoChannel {
+		public:
+			/**
+			 * Awaitable for receive().
+			 */
+			class ReceiveAwaiter {
+			public:
+				ReceiveAwaiter(CoChannel& channel): m_channel{channel} {}
+
+				bool await_ready() {
+					std::lock_guard<std::mutex> lock(m_channel.m_mutex);
+					return !m_channel.m_queue.empty();
+				}
+
+				bool await_suspend(std::coroutine_handle<> handle) {
+					std::lock_guard<std::mutex> lock(m_channel.m_mutex);
+					if (!m_channel.m_queue.empty()) return false;
+					if (m_channel.m_waiter) throw std::logic_error("Already receiving");
+					m_channel.m_waiter = handle;
+					return true;
+				}
+
+				CoMessage await_resume() {
+					std::lock_guard<std::mutex> lock(m_channel.m_mutex);
+					CoMessage result{std::move(m_channel.m_queue.front())};
+					m_channel.m_queue.pop_front();
+					return result;
+				}
+
+			private:
+				CoChannel& m_channel;
+			};
+
+			/**
+			 * Awaitable for ctrl().
+			 */
+			class CtrlAwaiter {
+			public:
+				CtrlAwaiter(CoChannel& channel,
+						std::unique_ptr<JsonX::Object>&& request,
+						const std::chrono::steady_clock::duration& timeout):
+					m_channel{channel}, m_request{std::move(request)},
+					m_timeout{timeout}
+				{}
+
+				bool await_ready() const noexcept { return false; }
+
+				bool await_suspend(std::coroutine_handle<> handle) {
+					m_channel.m_channel.ctrlAsync(std::move(m_request),
+						[this, handle](std::unique_ptr<JsonX::Object>&& response,
+								std::exception_ptr error)
+						{
+							m_response = std::move(response);
+							m_error = error;
+							// Whoever comes second continues the coroutine:
+							if (m_done.exchange(true)) m_channel.resume(handle);
+						}, m_timeout);
+					return !m_done.exchange(true);
+				}
+
+				std::unique_ptr<JsonX::Object> await_resume() {
+					if (m_error) std::rethrow_exception(m_error);
+					return std::move(m_response);
+				}
+
+			private:
+				CoChannel&                          m_channel;
+				std::unique_ptr<JsonX::Object>      m_request;
+				std::chrono::steady_clock::duration m_timeout;
+				std::unique_ptr<JsonX::Object>      m_response{};
+				std::exception_ptr                  m_error{};
+				std::atomic<bool>                   m_done{false};
+			};
+
+			/**
+			 * Constructor.
+			 * @param channel Channel to receive from and to send to.
+			 * @param executor Executor that resumes the waiting coroutine.
+			 *                 By default it is the timer worker pool, always
+			 *                 the same worker for one CoChannel. Without
+			 *                 "timerWorkers" the coroutine is resumed inline,
+			 *                 see above. Check executor() if that matters.
+			 */
+			CoChannel(Channel& channel, TimerExecutor executor = nullptr):
+				m_channel{channel}, m_executor{std::move(executor)}
+			{
+				if (!m_executor) {
+					static std::atomic<size_t> nextKey{0};
+					m_executor = env().timerManager.workerExecutor(nextKey++);
+				}
+				m_channel.receiveFunction = [this](
+						std::unique_ptr<JsonX::Object>&& message,
+						MessagePriority priority)
+				{
+					std::coroutine_handle<> waiter{};
+					{
+						std::lock_guard<std::mutex> lock(m_mutex);
+						m_queue.push_back(CoMessage{std::move(message), priority});
+						std::swap(waiter, m_waiter);
+					}
+					if (waiter) resume(waiter);
+				};
+			}
+
+			/**
+			 * You can not copy a CoChannel.
+			 * @param other Not used.
+			 */
+			CoChannel(const CoChannel& other) = delete;
+
+			/**
+			 * You can not assign a CoChannel.
+			 * @param other Not used.
+			 * @return Not used.
+			 */
+			CoChannel& operator=(const CoChannel& other) = delete;
+
+			/**
+			 * Destructor.
+			 */
+			~CoChannel() {
+				m_channel.receiveFunction = nullptr;
+			}
+
+			/**
+			 * Get the channel.
+			 * @return The channel.
+			 */
+			Channel& channel() { return m_channel; }
+
+			/**
+			 * Get the executor that resumes waiting coroutines.
+			 * @return The executor, nullptr if they are resumed inline.
+			 */
+			const TimerExecutor& executor() const { return m_executor; }
+
+			/**
+			 * Wait for the next message.
+			 * @return Awaitable that yields a CoMessage.
+			 */
+			ReceiveAwaiter receive() { return ReceiveAwaiter{*this}; }
+
+			/**
+			 * Send a request and wait for the response, without blocking
+			 * the thread.
+			 * @param request Request to send.
+			 * @param timeout Time to wait for the response, zero for ever.
+			 * @return Awaitable that yields the response or throws.
+			 */
+			CtrlAwaiter ctrl(std::unique_ptr<JsonX::Object>&& request,
+					const std::chrono::steady_clock::duration& timeout =
+							std::chrono::steady_clock::duration::zero())
+			{
+				return CtrlAwaiter{*this, std::move(request), timeout};
+			}
+
+		private:
+			void resume(std::coroutine_handle<> handle) {
+				if (m_executor)
+					m_executor([handle]() { handle.resume(); });
+				else
+					handle.resume();
+			}
+
+			Channel&                m_channel;
+			TimerExecutor           m_executor;
+			std::mutex              m_mutex{};
+			std::deque<CoMessage>   m_queue{};
+			std::coroutine_handle<> m_waiter{};
+		};
+
+		/**
+		 * Awaitable for sleep_for().
+		 */
+		class SleepAwaiter {
+		public:
+			SleepAwaiter(const std::chrono::steady_clock::duration& d,
+					TimerExecutor executor):
+				m_duration{d}, m_executor{std::move(executor)}
+			{}
+
+			bool await_ready() const noexcept {
+				return m_duration <= std::chrono::steady_clock::duration::zero();
+			}
+
+			void await_suspend(std::coroutine_handle<> handle) {
+				m_timer.reset(new Timer("sleep_for", m_duration,
+						[handle]() { handle.resume(); }));
+				if (m_executor) m_timer->setExecutor(m_executor);
+				m_timer->start();
+			}
+
+			void await_resume() const noexcept {}
+
+		private:
+			std::chrono::steady_clock::duration m_duration;
+			TimerExecutor                       m_executor;
+			std::unique_ptr<Timer>              m_timer{};
+		};
+
+		/**
+		 * Suspend the coroutine for some time. It is resumed like a timer
+		 * callback: on the timer worker pool, or on the timer thread if
+		 * there are no "timerWorkers".
+		 * @param d Time to sleep.
+		 * @param executor Executor that resumes the coroutine instead,
+		 *                 e.g. the one of a CoChannel.
+		 * @return Awaitable.
+		 */
+		inline SleepAwaiter sleep_for(const std::chrono::steady_clock::duration& d,
+				TimerExecutor executor = nullptr)
+		{
+			return SleepAwaiter{d, std::move(executor)};
+		}
+
+	} /* end namespace Runtime */
+} /* end namespace FreeAX25 */
+
+#endif /* __cpp_impl_coroutine */
+
+#endif /* FREEAX25_RUNTIME_CHANNELCOROUTINE_H_ */
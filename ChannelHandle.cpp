@@ -0,0 +1,140 @@
+/*
+    Project FreeAX25_Runtime
+    Copyright (C) 2015  tania@df9ry.de
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ChannelHandle.h"
+#include "Channel.h"
+#include "Environment.h"
+
+#include <stdexcept>
+
+using namespace std;
+
+namespace FreeAX25 {
+	namespace Runtime {
+
+		const size_t HandleTable::CHUNK_SIZE;
+		const size_t HandleTable::MAX_CHUNKS;
+
+		Channel* ChannelHandle::resolve() const
+		{
+			return env().channelHandles.resolve(*this);
+		}
+
+		bool ChannelHandle::valid() const
+		{
+			return resolve() != nullptr;
+		}
+
+		ChannelProxy ChannelHandle::proxy() const
+		{
+			Channel* channel = resolve();
+			return channel ? channel->getLocalProxy() : ChannelProxy();
+		}
+
+		void ChannelHandle::send(std::unique_ptr<JsonX::Object>&& message,
+				MessagePriority priority) const
+		{
+			Channel* channel = resolve();
+			if (!channel) throw runtime_error("Connection closed");
+			channel->onRemoteSend(move(message), priority);
+		}
+
+		SendResult ChannelHandle::trySend(std::unique_ptr<JsonX::Object>&& message,
+				MessagePriority priority) const
+		{
+			Channel* channel = resolve();
+			if (!channel) return SendResult::NOT_CONNECTED;
+			return channel->onRemoteTrySend(move(message), priority) ?
+					SendResult::OK : SendResult::WOULD_BLOCK;
+		}
+
+		void ChannelHandle::sendFrame(const Frame& frame,
+				MessagePriority priority) const
+		{
+			Channel* channel = resolve();
+			if (!channel) throw runtime_error("Connection closed");
+			channel->onRemoteSendFrame(frame, priority);
+		}
+
+		SendResult ChannelHandle::trySendFrame(const Frame& frame,
+				MessagePriority priority) const
+		{
+			Channel* channel = resolve();
+			if (!channel) return SendResult::NOT_CONNECTED;
+			return channel->onRemoteTrySendFrame(frame, priority) ?
+					SendResult::OK : SendResult::WOULD_BLOCK;
+		}
+
+		HandleTable::HandleTable()
+		{
+			for (size_t i = 0; i < MAX_CHUNKS; ++i)
+				m_chunks[i].store(nullptr, memory_order_relaxed);
+		}
+
+		HandleTable::~HandleTable()
+		{
+			for (size_t i = 0; i < MAX_CHUNKS; ++i)
+				delete[] m_chunks[i].load(memory_order_relaxed);
+		}
+
+		ChannelHandle HandleTable::acquire(Channel* channel)
+		{
+			lock_guard<mutex> lock(m_mutex);
+			uint32_t index;
+			if (!m_free.empty()) {
+				index = m_free.back();
+				m_free.pop_back();
+			}
+			else {
+				if (m_used >= MAX_CHUNKS * CHUNK_SIZE)
+					throw runtime_error("Too many channels");
+				index = m_used++;
+				if (index % CHUNK_SIZE == 0)
+					m_chunks[index / CHUNK_SIZE].store(new Slot[CHUNK_SIZE],
+							memory_order_release);
+			}
+			Slot& slot = m_chunks[index / CHUNK_SIZE].load(memory_order_relaxed)[index % CHUNK_SIZE];
+			slot.channel.store(channel, memory_order_release);
+			++m_size;
+			return ChannelHandle(index, slot.generation.load(memory_order_relaxed));
+		}
+
+		void HandleTable::release(const ChannelHandle& handle)
+		{
+			lock_guard<mutex> lock(m_mutex);
+			if (handle.m_index >= m_used) return;
+			Slot& slot = m_chunks[handle.m_index / CHUNK_SIZE].load(
+					memory_order_relaxed)[handle.m_index % CHUNK_SIZE];
+			uint32_t generation = slot.generation.load(memory_order_relaxed);
+			if (generation != handle.m_generation) return; // Already released
+			// Zero means "no handle", skip it:
+			if (++generation == 0) ++generation;
+			slot.generation.store(generation, memory_order_release);
+			slot.channel.store(nullptr, memory_order_release);
+			m_free.push_back(handle.m_index);
+			--m_size;
+		}
+
+		size_t HandleTable::size() const
+		{
+			lock_guard<mutex> lock(m_mutex);
+			return m_size;
+		}
+
+	} /* end namespace Runtime */
+} /* end namespace FreeAX25 */
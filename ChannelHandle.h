@@ -0,0 +1,239 @@
+/*
+    Project FreeAX25_Runtime
+    Copyright (C) 2015  tania@df9ry.de
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file */
+
+#ifndef FREEAX25_RUNTIME_CHANNELHANDLE_H_
+#define FREEAX25_RUNTIME_CHANNELHANDLE_H_
+
+#include "ChannelProxy.h"
+#include "Frame.h"
+
+#include <JsonXValue.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace FreeAX25 {
+	namespace Runtime {
+
+		class Channel;
+
+		/**
+		 * Non owning reference to a Channel. It is a generation checked
+		 * index into the HandleTable, so copying and validating it needs
+		 * no atomic read-modify-write. Once the channel is reset or
+		 * destroyed the handle is stale and every call on it fails.
+		 *
+		 * A handle does not keep the session alive. Use it only where an
+		 * owning ChannelProxy to the same channel is held elsewhere, e.g.
+		 * for the hot path of a session that stores its peers' proxies.
+		 */
+		class ChannelHandle {
+			friend class HandleTable;
+
+		public:
+			/**
+			 * Default constructor. The handle refers to nothing.
+			 */
+			ChannelHandle() {}
+
+			/**
+			 * Test if the handle was set. It might be stale anyway.
+			 */
+			explicit operator bool() const noexcept { return m_generation != 0; }
+
+			/**
+			 * Test if the handle still refers to a live channel.
+			 * @return If the handle is not stale.
+			 */
+			bool valid() const;
+
+			/**
+			 * Get an owning proxy for the channel.
+			 * @return ChannelProxy, empty if the handle is stale.
+			 */
+			ChannelProxy proxy() const;
+
+			/**
+			 * Send a message to the channel.
+			 * @param message Message to send.
+			 * @param priority Message priority.
+			 */
+			void send(std::unique_ptr<JsonX::Object>&& message,
+					MessagePriority priority = MessagePriority::ROUTINE) const;
+
+			/**
+			 * Send a message to the channel without blocking.
+			 * @param message Message to send. It is moved only on success.
+			 * @param priority Message priority.
+			 * @return Result of the send.
+			 */
+			SendResult trySend(std::unique_ptr<JsonX::Object>&& message,
+					MessagePriority priority = MessagePriority::ROUTINE) const;
+
+			/**
+			 * Send a binary frame to the channel.
+			 * @param frame Frame to send.
+			 * @param priority Message priority.
+			 */
+			void sendFrame(const Frame& frame,
+					MessagePriority priority = MessagePriority::ROUTINE) const;
+
+			/**
+			 * Send a binary frame to the channel without blocking.
+			 * @param frame Frame to send.
+			 * @param priority Message priority.
+			 * @return Result of the send.
+			 */
+			SendResult trySendFrame(const Frame& frame,
+					MessagePriority priority = MessagePriority::ROUTINE) const;
+
+			/**
+			 * Compare two handles.
+			 * @param other Other handle.
+			 * @return If both refer to the same slot and generation.
+			 */
+			bool operator==(const ChannelHandle& other) const {
+				return (m_index == other.m_index) && (m_generation == other.m_generation);
+			}
+
+			/**
+			 * Compare two handles.
+			 * @param other Other handle.
+			 * @return If the handles differ.
+			 */
+			bool operator!=(const ChannelHandle& other) const {
+				return !(*this == other);
+			}
+
+		private:
+			ChannelHandle(uint32_t index, uint32_t generation):
+				m_index{index}, m_generation{generation} {}
+
+			Channel* resolve() const;
+
+			uint32_t m_index{0};
+			uint32_t m_generation{0};
+		};
+
+		/**
+		 * Table of all channels that ChannelHandles refer to. It grows in
+		 * chunks that are never moved, so resolve() works without locks.
+		 * Only acquire() and release() lock.
+		 */
+		class HandleTable {
+		public:
+			/**
+			 * Constructor.
+			 */
+			HandleTable();
+
+			/**
+			 * You can not copy a HandleTable.
+			 * @param other Not used.
+			 */
+			HandleTable(const HandleTable& other) = delete;
+
+			/**
+			 * You can not move a HandleTable.
+			 * @param other Not used.
+			 */
+			HandleTable(HandleTable&& other) = delete;
+
+			/**
+			 * You can not assign a HandleTable.
+			 * @param other Not used.
+			 * @return Not used.
+			 */
+			HandleTable& operator=(const HandleTable& other) = delete;
+
+			/**
+			 * You can not assign a HandleTable.
+			 * @param other Not used.
+			 * @return Not used.
+			 */
+			HandleTable& operator=(HandleTable&& other) = delete;
+
+			/**
+			 * Destructor.
+			 */
+			~HandleTable();
+
+			/**
+			 * Register a channel.
+			 * @param channel The channel.
+			 * @return Handle for the channel.
+			 */
+			ChannelHandle acquire(Channel* channel);
+
+			/**
+			 * Unregister a channel. All its handles become stale.
+			 * @param handle Handle from acquire().
+			 */
+			void release(const ChannelHandle& handle);
+
+			/**
+			 * Look up the channel of a handle. Lock free.
+			 * @param handle The handle.
+			 * @return The channel or nullptr if the handle is stale.
+			 */
+			Channel* resolve(const ChannelHandle& handle) const {
+				if (handle.m_index >= MAX_CHUNKS * CHUNK_SIZE) return nullptr;
+				Slot* chunk = m_chunks[handle.m_index / CHUNK_SIZE].load(
+						std::memory_order_acquire);
+				if (!chunk) return nullptr;
+				Slot& slot = chunk[handle.m_index % CHUNK_SIZE];
+				// Check the generation after reading the channel, so a
+				// slot that was reused in between is detected:
+				Channel* channel = slot.channel.load(std::memory_order_acquire);
+				if (slot.generation.load(std::memory_order_acquire) != handle.m_generation)
+					return nullptr;
+				return channel;
+			}
+
+			/**
+			 * Get the number of registered channels.
+			 * @return Number of registered channels.
+			 */
+			size_t size() const;
+
+		private:
+			static const size_t CHUNK_SIZE = 1024;
+			static const size_t MAX_CHUNKS = 4096;
+
+			struct Slot {
+				std::atomic<Channel*> channel{nullptr};
+				std::atomic<uint32_t> generation{1};
+			};
+
+			std::atomic<Slot*>    m_chunks[MAX_CHUNKS];
+			mutable std::mutex    m_mutex{};
+			std::vector<uint32_t> m_free{};
+			uint32_t              m_used{0};
+			size_t                m_size{0};
+		};
+
+	} /* end namespace Runtime */
+} /* end namespace FreeAX25 */
+
+#endif /* FREEAX25_RUNTIME_CHANNELHANDLE_H_ */
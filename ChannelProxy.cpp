@@ -20,6 +20,7 @@
 
 #include "Channel.h"
 #include "ChannelProxy.h"
+#include "Environment.h"
 #include "SessionBase.h"
 
 using namespace std;
@@ -44,6 +45,26 @@ namespace FreeAX25 {
 		{
 		}
 
+		ChannelProxy ChannelProxy::connect(ChannelProxy backlink)
+		{
+			return connect(backlink, env().messagePool.acquire());
+		}
+
+		ChannelProxy ChannelProxy::connect()
+		{
+			return connect(ChannelProxy(), env().messagePool.acquire());
+		}
+
+		void ChannelProxy::open()
+		{
+			open(env().messagePool.acquire());
+		}
+
+		void ChannelProxy::close()
+		{
+			close(env().messagePool.acquire());
+		}
+
 		ChannelProxy ChannelProxy::connect(ChannelProxy backlink, std::unique_ptr<JsonX::Object>&& parameter)
 		{
 			if (!m_channel) throw runtime_error("Connection closed");
@@ -69,12 +90,84 @@ namespace FreeAX25 {
 			m_channel->onRemoteSend(move(message), priority);
 		}
 
+		SendResult ChannelProxy::trySend(std::unique_ptr<JsonX::Object>&& message,
+				MessagePriority priority)
+		{
+			if (!m_channel) return SendResult::NOT_CONNECTED;
+			return m_channel->onRemoteTrySend(move(message), priority) ?
+					SendResult::OK : SendResult::WOULD_BLOCK;
+		}
+
+		void ChannelProxy::sendBatch(std::vector<std::unique_ptr<JsonX::Object>>&& messages,
+				MessagePriority priority)
+		{
+			if (!m_channel) throw runtime_error("Connection closed");
+			m_channel->onRemoteSendBatch(move(messages), priority);
+		}
+
+		void ChannelProxy::sendFrame(const Frame& frame,
+				MessagePriority priority)
+		{
+			if (!m_channel) throw runtime_error("Connection closed");
+			m_channel->onRemoteSendFrame(frame, priority);
+		}
+
+		SendResult ChannelProxy::trySendFrame(const Frame& frame,
+				MessagePriority priority)
+		{
+			if (!m_channel) return SendResult::NOT_CONNECTED;
+			return m_channel->onRemoteTrySendFrame(frame, priority) ?
+					SendResult::OK : SendResult::WOULD_BLOCK;
+		}
+
+		void ChannelProxy::grant(size_t credits)
+		{
+			if (!m_channel) throw runtime_error("Connection closed");
+			m_channel->onRemoteGrant(credits);
+		}
+
+		size_t ChannelProxy::creditWindow() const
+		{
+			return m_channel ? m_channel->m_creditWindow : 0;
+		}
+
 		std::unique_ptr<JsonX::Object> ChannelProxy::ctrl(std::unique_ptr<JsonX::Object>&& request)
 		{
 			if (!m_channel) throw runtime_error("Connection closed");
 			return m_channel->onRemoteCtrl(move(request));
 		}
 
+		void ChannelProxy::ctrlAsync(std::unique_ptr<JsonX::Object>&& request,
+				CtrlCompletion completion,
+				const std::chrono::steady_clock::duration& timeout)
+		{
+			if (!m_channel) throw runtime_error("Connection closed");
+			m_channel->onRemoteCtrlAsync(move(request),
+					CtrlReply(move(completion), timeout));
+		}
+
+		std::future<std::unique_ptr<JsonX::Object>> ChannelProxy::ctrlFuture(
+				std::unique_ptr<JsonX::Object>&& request,
+				const std::chrono::steady_clock::duration& timeout)
+		{
+			auto promise = make_shared<std::promise<std::unique_ptr<JsonX::Object>>>();
+			std::future<std::unique_ptr<JsonX::Object>> result{promise->get_future()};
+			ctrlAsync(move(request), [promise](
+					std::unique_ptr<JsonX::Object>&& response, exception_ptr error)
+			{
+				if (error)
+					promise->set_exception(error);
+				else
+					promise->set_value(move(response));
+			}, timeout);
+			return result;
+		}
+
+		ChannelHandle ChannelProxy::handle() const
+		{
+			return m_channel ? m_channel->getHandle() : ChannelHandle();
+		}
+
 		void ChannelProxy::reset()
 		{
 			m_channel = nullptr;
@@ -87,5 +180,9 @@ namespace FreeAX25 {
 			return m_session ? m_session.get()->id() : nullId;
 		}
 
+		SessionId ChannelProxy::sessionId() const {
+			return m_session ? m_session->sessionId() : SessionId();
+		}
+
 	} /* end namespace Runtime */
 } /* end namespace FreeAX25 */
@@ -21,9 +21,16 @@
 #ifndef FREEAX25_RUNTIME_CHANNELPROXY_H_
 #define FREEAX25_RUNTIME_CHANNELPROXY_H_
 
+#include "CtrlReply.h"
+#include "Frame.h"
+#include "SessionId.h"
+
 #include <JsonXValue.h>
 
+#include <chrono>
+#include <future>
 #include <memory>
+#include <vector>
 
 namespace FreeAX25 {
 	namespace Runtime {
@@ -36,7 +43,17 @@ namespace FreeAX25 {
 			PRIORITY//!< PRIORITY Express delivery
 		};
 
+		/**
+		 * Result of a non blocking send.
+		 */
+		enum class SendResult {
+			OK,           //!< OK            Message was delivered or queued
+			WOULD_BLOCK,  //!< WOULD_BLOCK   No credit or queue full, try later
+			NOT_CONNECTED //!< NOT_CONNECTED Channel is not connected
+		};
+
 		class Channel;
+		class ChannelHandle;
 		class SessionBase;
 
 		/**
@@ -76,9 +93,7 @@ namespace FreeAX25 {
 			 * @param backlink ChannelProxy for backlink.
 			 * @return ServerProxy where subsequent requests can be sent to.
 			 */
-			ChannelProxy connect(ChannelProxy backlink) {
-				return connect(backlink, JsonX::Object::make());
-			}
+			ChannelProxy connect(ChannelProxy backlink);
 
 			/**
 			 * Connect to the channel.
@@ -93,9 +108,7 @@ namespace FreeAX25 {
 			 * Connect to the channel.
 			 * @return ChannelProxy where subsequent requests can be sent to.
 			 */
-			ChannelProxy connect() {
-				return connect(ChannelProxy(), JsonX::Object::make());
-			}
+			ChannelProxy connect();
 
 			/**
 			 * Open connection to channel. This should be the first call after
@@ -108,9 +121,7 @@ namespace FreeAX25 {
 			 * Open connection to channel. This should be the first call after
 			 * a connect.
 			 */
-			void open() {
-				open(JsonX::Object::make());
-			}
+			void open();
 
 			/**
 			 * Close connection to channel. This should be the last call.
@@ -121,9 +132,7 @@ namespace FreeAX25 {
 			/**
 			 * Close connection to channel. This should be the last call.
 			 */
-			void close() {
-				close(JsonX::Object::make());
-			}
+			void close();
 
 			/**
 			 * Send a message to the channel.
@@ -133,6 +142,55 @@ namespace FreeAX25 {
 			void send(std::unique_ptr<JsonX::Object>&& message,
 					MessagePriority priority = MessagePriority::ROUTINE);
 
+			/**
+			 * Send a message to the channel without throwing, if it can not
+			 * be queued.
+			 * @param message Message to send. It is moved only on success.
+			 * @param priority Message priority.
+			 * @return Result of the send.
+			 */
+			SendResult trySend(std::unique_ptr<JsonX::Object>&& message,
+					MessagePriority priority = MessagePriority::ROUTINE);
+
+			/**
+			 * Send a batch of messages to the channel with one call.
+			 * @param messages Messages to send.
+			 * @param priority Message priority for all messages.
+			 */
+			void sendBatch(std::vector<std::unique_ptr<JsonX::Object>>&& messages,
+					MessagePriority priority = MessagePriority::ROUTINE);
+
+			/**
+			 * Send a binary frame to the channel. The payload is shared,
+			 * not copied.
+			 * @param frame Frame to send.
+			 * @param priority Message priority.
+			 */
+			void sendFrame(const Frame& frame,
+					MessagePriority priority = MessagePriority::ROUTINE);
+
+			/**
+			 * Send a binary frame to the channel without throwing, if it can
+			 * not be queued.
+			 * @param frame Frame to send.
+			 * @param priority Message priority.
+			 * @return Result of the send.
+			 */
+			SendResult trySendFrame(const Frame& frame,
+					MessagePriority priority = MessagePriority::ROUTINE);
+
+			/**
+			 * Grant credits to the channel.
+			 * @param credits Number of messages the channel may send more.
+			 */
+			void grant(size_t credits);
+
+			/**
+			 * Get the credit window of the channel.
+			 * @return Credit window, 0 if the channel is not flow controlled.
+			 */
+			size_t creditWindow() const;
+
 			/**
 			 * Send a request to the channel.
 			 * @param request Request to send.
@@ -140,12 +198,52 @@ namespace FreeAX25 {
 			 */
 			std::unique_ptr<JsonX::Object> ctrl(std::unique_ptr<JsonX::Object>&& request);
 
+			/**
+			 * Send a request to the channel without waiting for the
+			 * response.
+			 * @param request Request to send.
+			 * @param completion Gets the response or the error. It runs on
+			 *                   the thread that answers, or on the timer
+			 *                   thread on timeout. A request that is
+			 *                   dropped without an answer fails with
+			 *                   "No answer".
+			 * @param timeout Time to wait for the response, zero for ever.
+			 */
+			void ctrlAsync(std::unique_ptr<JsonX::Object>&& request,
+					CtrlCompletion completion,
+					const std::chrono::steady_clock::duration& timeout =
+							std::chrono::steady_clock::duration::zero());
+
+			/**
+			 * Send a request to the channel without waiting for the
+			 * response.
+			 * @param request Request to send.
+			 * @param timeout Time to wait for the response, zero for ever.
+			 * @return Future for the response.
+			 */
+			std::future<std::unique_ptr<JsonX::Object>> ctrlFuture(
+					std::unique_ptr<JsonX::Object>&& request,
+					const std::chrono::steady_clock::duration& timeout =
+							std::chrono::steady_clock::duration::zero());
+
+			/**
+			 * Get a non owning handle to the channel.
+			 * @return ChannelHandle, empty if the proxy is not set.
+			 */
+			ChannelHandle handle() const;
+
 			/**
 			 * Get session id.
 			 * @return Session id.
 			 */
 			const std::string& id() const;
 
+			/**
+			 * Get session id.
+			 * @return Session id, the nil id if the proxy is not set.
+			 */
+			SessionId sessionId() const;
+
 			/**
 			 * Get numerical address of the underlying channel. For debugging purposes.
 			 * @return Numerical address of the underlying channel.
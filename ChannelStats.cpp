@@ -0,0 +1,71 @@
+/*
+    Project FreeAX25_Runtime
+    Copyright (C) 2015  tania@df9ry.de
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ChannelStats.h"
+#include "Environment.h"
+#include "Setting.h"
+
+using namespace std;
+
+namespace FreeAX25 {
+	namespace Runtime {
+
+		const size_t ChannelStats::HISTOGRAM_BUCKETS;
+
+		std::atomic<bool> ChannelStats::s_enabledByDefault{false};
+
+		void ChannelStats::init() {
+			bool enabled = Setting::asBoolValue(env().configuration.settings,
+					"channelStats", false);
+			s_enabledByDefault = enabled;
+			INF(string("Set channel statistics ") + (enabled ? "on" : "off"));
+		}
+
+		static unique_ptr<JsonX::Object> laneToJson(
+				const atomic<uint64_t>& messages, const atomic<uint64_t>& bytes)
+		{
+			unique_ptr<JsonX::Object> result{JsonX::Object::make()};
+			result->set("messages", JsonX::Number::make(
+					messages.load(memory_order_relaxed)));
+			result->set("bytes", JsonX::Number::make(
+					bytes.load(memory_order_relaxed)));
+			return result;
+		}
+
+		std::unique_ptr<JsonX::Object> ChannelStats::toJson() const {
+			unique_ptr<JsonX::Object> sent{JsonX::Object::make()};
+			sent->set("routine", laneToJson(m_sent[0].messages, m_sent[0].bytes));
+			sent->set("priority", laneToJson(m_sent[1].messages, m_sent[1].bytes));
+			unique_ptr<JsonX::Object> received{JsonX::Object::make()};
+			received->set("routine", laneToJson(m_received[0].messages, m_received[0].bytes));
+			received->set("priority", laneToJson(m_received[1].messages, m_received[1].bytes));
+			unique_ptr<JsonX::Array> histogram{JsonX::Array::make()};
+			for (size_t i = 0; i < HISTOGRAM_BUCKETS; ++i)
+				histogram->append(JsonX::Number::make(
+						m_histogram[i].load(memory_order_relaxed)));
+			unique_ptr<JsonX::Object> result{JsonX::Object::make()};
+			result->set("enabled", JsonX::Bool::make(true));
+			result->set("sent", move(sent));
+			result->set("received", move(received));
+			result->set("errors", JsonX::Number::make(m_errors.load(memory_order_relaxed)));
+			result->set("receiveTime", move(histogram));
+			return result;
+		}
+
+	} /* end namespace Runtime */
+} /* end namespace FreeAX25 */
@@ -0,0 +1,153 @@
+/*
+    Project FreeAX25_Runtime
+    Copyright (C) 2015  tania@df9ry.de
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file */
+
+#ifndef FREEAX25_RUNTIME_CHANNELSTATS_H_
+#define FREEAX25_RUNTIME_CHANNELSTATS_H_
+
+#include "ChannelProxy.h"
+
+#include <JsonXValue.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace FreeAX25 {
+	namespace Runtime {
+
+		/**
+		 * Traffic and latency counters of a Channel. All counters are
+		 * relaxed atomics, so updating them is cheap and never blocks.
+		 * Bytes are only counted for frames. JSON messages count as
+		 * messages with 0 bytes, because their size is not known without
+		 * serializing them.
+		 */
+		class ChannelStats {
+		public:
+			/**
+			 * Number of buckets of the receive time histogram. Bucket i
+			 * counts run times from 2^i to 2^(i+1) nanoseconds, the last
+			 * bucket counts everything above.
+			 */
+			static const size_t HISTOGRAM_BUCKETS = 32;
+
+			/**
+			 * Constructor.
+			 */
+			ChannelStats() {}
+
+			/**
+			 * You can not copy ChannelStats.
+			 * @param other Not used.
+			 */
+			ChannelStats(const ChannelStats& other) = delete;
+
+			/**
+			 * You can not assign ChannelStats.
+			 * @param other Not used.
+			 * @return Not used.
+			 */
+			ChannelStats& operator=(const ChannelStats& other) = delete;
+
+			/**
+			 * Destructor.
+			 */
+			~ChannelStats() {}
+
+			/**
+			 * Count a sent message.
+			 * @param priority Message priority.
+			 * @param bytes Payload size of a frame, 0 for a message.
+			 */
+			void countSent(MessagePriority priority, size_t bytes = 0) {
+				Lane& lane = m_sent[index(priority)];
+				lane.messages.fetch_add(1, std::memory_order_relaxed);
+				if (bytes) lane.bytes.fetch_add(bytes, std::memory_order_relaxed);
+			}
+
+			/**
+			 * Count a received message.
+			 * @param priority Message priority.
+			 * @param bytes Payload size of a frame, 0 for a message.
+			 * @param ns Run time of the receiving handler in nanoseconds.
+			 */
+			void countReceived(MessagePriority priority, size_t bytes, uint64_t ns) {
+				Lane& lane = m_received[index(priority)];
+				lane.messages.fetch_add(1, std::memory_order_relaxed);
+				if (bytes) lane.bytes.fetch_add(bytes, std::memory_order_relaxed);
+				m_histogram[bucket(ns)].fetch_add(1, std::memory_order_relaxed);
+			}
+
+			/**
+			 * Count an error that was thrown from a handler.
+			 */
+			void countError() {
+				m_errors.fetch_add(1, std::memory_order_relaxed);
+			}
+
+			/**
+			 * Get a snapshot of all counters.
+			 * @return Counters as an object.
+			 */
+			std::unique_ptr<JsonX::Object> toJson() const;
+
+			/**
+			 * Global switch for new channels. Read from the setting
+			 * "channelStats", default is false.
+			 * @return If new channels keep statistics.
+			 */
+			static bool enabledByDefault() {
+				return s_enabledByDefault.load(std::memory_order_relaxed);
+			}
+
+			/**
+			 * Initialize the global switch from the configuration.
+			 */
+			static void init();
+
+		private:
+			struct Lane {
+				std::atomic<uint64_t> messages{0};
+				std::atomic<uint64_t> bytes{0};
+			};
+
+			static size_t index(MessagePriority priority) {
+				return (priority == MessagePriority::PRIORITY) ? 1 : 0;
+			}
+
+			static size_t bucket(uint64_t ns) {
+				size_t i = 0;
+				while ((ns >>= 1) && (i < HISTOGRAM_BUCKETS - 1)) ++i;
+				return i;
+			}
+
+			Lane                  m_sent[2];
+			Lane                  m_received[2];
+			std::atomic<uint64_t> m_errors{0};
+			std::atomic<uint64_t> m_histogram[HISTOGRAM_BUCKETS] {};
+
+			static std::atomic<bool> s_enabledByDefault;
+		};
+
+	} /* end namespace Runtime */
+} /* end namespace FreeAX25 */
+
+#endif /* FREEAX25_RUNTIME_CHANNELSTATS_H_ */
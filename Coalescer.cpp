@@ -0,0 +1,125 @@
+/*
+    Project FreeAX25_Runtime
+    Copyright (C) 2015  tania@df9ry.de
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Coalescer.h"
+#include "Environment.h"
+
+#include <stdexcept>
+
+using namespace std;
+using namespace std::chrono;
+
+namespace FreeAX25 {
+	namespace Runtime {
+
+		Coalescer::Coalescer(ChannelProxy target, size_t maxCount,
+				const steady_clock::duration& window):
+			SessionBase(Publish::LATER),
+			m_input{m_pointer},
+			m_output{m_pointer},
+			m_maxCount{(maxCount > 0) ? maxCount : 1},
+			m_timer{"coalescer", window, [this]() { flush(); }}
+		{
+			setRemote(m_output, target);
+			m_input.connectFunction = [this](ChannelProxy backlink,
+					std::unique_ptr<JsonX::Object>&& parameter)
+			{
+				return m_input.getLocalProxy();
+			};
+			m_input.openFunction = [this](std::unique_ptr<JsonX::Object>&& parameter)
+			{
+				m_output.open(move(parameter));
+			};
+			m_input.closeFunction = [this](std::unique_ptr<JsonX::Object>&& parameter)
+			{
+				flush();
+				m_output.close(move(parameter));
+			};
+			m_input.ctrlFunction = [this](std::unique_ptr<JsonX::Object>&& request)
+			{
+				return m_output.ctrl(move(request));
+			};
+			m_input.receiveFrameFunction = [this](const Frame& frame,
+					MessagePriority priority)
+			{
+				m_output.sendFrame(frame, priority);
+			};
+			m_input.receiveFunction = [this](std::unique_ptr<JsonX::Object>&& message,
+					MessagePriority priority)
+			{
+				if (priority == MessagePriority::PRIORITY) {
+					m_output.send(move(message), priority);
+					return;
+				}
+				std::unique_ptr<JsonX::Array> full{};
+				{
+					lock_guard<mutex> lock(m_mutex);
+					if (!m_batch) {
+						m_batch = JsonX::Array::make();
+						m_timer.start();
+					}
+					m_batch->append(move(message));
+					if (m_batch->size() >= m_maxCount) {
+						m_timer.stop();
+						full = move(m_batch);
+					}
+				}
+				if (full) {
+					std::unique_ptr<JsonX::Object> aggregate{JsonX::Object::make()};
+					aggregate->set("messages", move(full));
+					m_output.send(move(aggregate), MessagePriority::ROUTINE);
+				}
+			};
+			publish();
+		}
+
+		Coalescer::~Coalescer()
+		{
+			m_timer.stop();
+		}
+
+		void Coalescer::flush()
+		{
+			std::unique_ptr<JsonX::Array> batch{};
+			{
+				lock_guard<mutex> lock(m_mutex);
+				if (!m_batch) return;
+				m_timer.stop();
+				batch = move(m_batch);
+			}
+			std::unique_ptr<JsonX::Object> aggregate{JsonX::Object::make()};
+			aggregate->set("messages", move(batch));
+			m_output.send(move(aggregate), MessagePriority::ROUTINE);
+		}
+
+		void Coalescer::reset()
+		{
+			try {
+				flush();
+			}
+			catch (const exception& ex) {
+				env().logError(string("Coalescer flush with exception: ") + ex.what());
+			}
+			m_timer.stop();
+			m_input.reset();
+			m_output.reset();
+			SessionBase::reset(); // Might call delete!
+		}
+
+	} /* end namespace Runtime */
+} /* end namespace FreeAX25 */
@@ -0,0 +1,94 @@
+/*
+    Project FreeAX25_Runtime
+    Copyright (C) 2015  tania@df9ry.de
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file */
+
+#ifndef FREEAX25_RUNTIME_COALESCER_H_
+#define FREEAX25_RUNTIME_COALESCER_H_
+
+#include "Channel.h"
+#include "ChannelProxy.h"
+#include "SessionBase.h"
+#include "Timer.h"
+
+#include <JsonXValue.h>
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+
+namespace FreeAX25 {
+	namespace Runtime {
+
+		/**
+		 * Stage between two channels that gathers ROUTINE messages and
+		 * forwards them as one aggregated message
+		 * {"messages":[...]}. The batch goes out when it is full or when
+		 * the time window after its first message has passed, whatever
+		 * comes first. PRIORITY messages, frames, open, close and control
+		 * requests pass straight through. A close flushes first.
+		 *
+		 * Connect the sending channel to proxy(). The aggregated messages
+		 * go to the target that is given to the constructor.
+		 */
+		class Coalescer: public SessionBase {
+		public:
+			/**
+			 * Constructor.
+			 * @param target Where the aggregated messages go to.
+			 * @param maxCount Maximal number of messages in one batch.
+			 * @param window Maximal time a message waits for the batch.
+			 */
+			Coalescer(ChannelProxy target, size_t maxCount,
+					const std::chrono::steady_clock::duration& window);
+
+			/**
+			 * Destructor.
+			 */
+			virtual ~Coalescer();
+
+			/**
+			 * Get the proxy the sending channel has to connect to.
+			 * @return ChannelProxy of the stage.
+			 */
+			ChannelProxy proxy() { return m_input.getLocalProxy(); }
+
+			/**
+			 * Forward the current batch now, if there is one.
+			 */
+			void flush();
+
+			/**
+			 * Flush and release the stage. It is not usable after that.
+			 */
+			virtual void reset() override;
+
+		private:
+			Channel                        m_input;
+			Channel                        m_output;
+			const size_t                   m_maxCount;
+			std::mutex                     m_mutex{};
+			std::unique_ptr<JsonX::Array>  m_batch{};
+			Timer                          m_timer;
+		};
+
+	} /* end namespace Runtime */
+} /* end namespace FreeAX25 */
+
+#endif /* FREEAX25_RUNTIME_COALESCER_H_ */
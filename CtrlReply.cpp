@@ -0,0 +1,104 @@
+/*
+    Project FreeAX25_Runtime
+    Copyright (C) 2015  tania@df9ry.de
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CtrlReply.h"
+#include "Environment.h"
+#include "Timer.h"
+
+#include <atomic>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+using namespace std::chrono;
+
+namespace FreeAX25 {
+	namespace Runtime {
+
+		struct CtrlReply::State {
+			atomic<bool>      done{false};
+			CtrlCompletion    completion{};
+			unique_ptr<Timer> timer{};
+			~State();
+		};
+
+		CtrlReply::State::~State() {
+			// The last handle is gone without an answer, e.g. because the
+			// peer dropped it or the channel was reset:
+			if (done.exchange(true) || !completion) return;
+			CtrlCompletion f{move(completion)};
+			try {
+				f(nullptr, make_exception_ptr(runtime_error("No answer")));
+			}
+			catch (const exception& ex) {
+				env().logError(
+						string("Ctrl completion with exception: ") +
+						ex.what());
+			}
+			catch (...) {
+				env().logError(
+						string("Ctrl completion with unknown exception"));
+			}
+		}
+
+		CtrlReply::CtrlReply(CtrlCompletion completion,
+				const steady_clock::duration& timeout):
+			m_state{make_shared<State>()}
+		{
+			if (!completion) throw invalid_argument("No completion");
+			m_state->completion = move(completion);
+			if (timeout > steady_clock::duration::zero()) {
+				// The timer must not keep the request alive:
+				weak_ptr<State> weak{m_state};
+				m_state->timer.reset(new Timer("ctrlAsync", timeout, [weak]() {
+					shared_ptr<State> state{weak.lock()};
+					if (state) finish(state, nullptr,
+							make_exception_ptr(runtime_error("Timeout")));
+				}));
+				m_state->timer->start();
+			}
+		}
+
+		bool CtrlReply::finish(const shared_ptr<State>& state,
+				unique_ptr<JsonX::Object>&& response, exception_ptr error)
+		{
+			if (!state) throw runtime_error("Invalid reply");
+			if (state->done.exchange(true)) return false;
+			if (state->timer) state->timer->stop();
+			CtrlCompletion completion{move(state->completion)};
+			completion(move(response), error);
+			return true;
+		}
+
+		bool CtrlReply::complete(unique_ptr<JsonX::Object>&& response)
+		{
+			return finish(m_state, move(response), nullptr);
+		}
+
+		bool CtrlReply::fail(exception_ptr error)
+		{
+			return finish(m_state, nullptr, error);
+		}
+
+		bool CtrlReply::done() const
+		{
+			return m_state && m_state->done.load();
+		}
+
+	} /* end namespace Runtime */
+} /* end namespace FreeAX25 */
@@ -0,0 +1,103 @@
+/*
+    Project FreeAX25_Runtime
+    Copyright (C) 2015  tania@df9ry.de
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file */
+
+#ifndef FREEAX25_RUNTIME_CTRLREPLY_H_
+#define FREEAX25_RUNTIME_CTRLREPLY_H_
+
+#include <JsonXValue.h>
+
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <memory>
+
+namespace FreeAX25 {
+	namespace Runtime {
+
+		/**
+		 * Completion of an asynchronous control request. Gets either the
+		 * response or an exception.
+		 */
+		typedef std::function<void(std::unique_ptr<JsonX::Object>&& response,
+				std::exception_ptr error)> CtrlCompletion;
+
+		/**
+		 * Handle to answer an asynchronous control request. It can be
+		 * copied and answered later from any thread. Only the first answer
+		 * counts, later ones and answers after the timeout are ignored. If
+		 * the last copy is destroyed without an answer the completion gets
+		 * a runtime_error "No answer" on that thread.
+		 */
+		class CtrlReply {
+		public:
+			/**
+			 * Default constructor. The handle is not usable.
+			 */
+			CtrlReply() {}
+
+			/**
+			 * Constructor.
+			 * @param completion Completion to call with the answer.
+			 * @param timeout Time to wait for the answer. After that the
+			 *                completion gets a runtime_error "Timeout". Zero
+			 *                for no timeout.
+			 */
+			CtrlReply(CtrlCompletion completion,
+					const std::chrono::steady_clock::duration& timeout);
+
+			/**
+			 * Answer the request.
+			 * @param response Response to the request.
+			 * @return false if the request was already answered.
+			 */
+			bool complete(std::unique_ptr<JsonX::Object>&& response);
+
+			/**
+			 * Answer the request with an error.
+			 * @param error Exception for the requester.
+			 * @return false if the request was already answered.
+			 */
+			bool fail(std::exception_ptr error);
+
+			/**
+			 * Test if the request was already answered or timed out.
+			 * @return If the request is done.
+			 */
+			bool done() const;
+
+			/**
+			 * Test if the handle is usable.
+			 */
+			explicit operator bool() const noexcept { return m_state != nullptr; }
+
+		private:
+			struct State;
+
+			static bool finish(const std::shared_ptr<State>& state,
+					std::unique_ptr<JsonX::Object>&& response,
+					std::exception_ptr error);
+
+			std::shared_ptr<State> m_state{};
+		};
+
+	} /* end namespace Runtime */
+} /* end namespace FreeAX25 */
+
+#endif /* FREEAX25_RUNTIME_CTRLREPLY_H_ */
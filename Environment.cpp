@@ -17,6 +17,7 @@
  */
 
 #include "Environment.h"
+#include "ChannelStats.h"
 
 #include <stdexcept>
 
@@ -30,6 +31,11 @@ namespace FreeAX25 {
 		Environment::~Environment() {
 		}
 
+		void Environment::init() {
+			messagePool.init();
+			ChannelStats::init();
+		}
+
 		static Environment* environment{};
 
 		Environment& env() {
@@ -21,11 +21,15 @@
 #ifndef FREEAX25_RUNTIME_ENVIRONMENT_H_
 #define FREEAX25_RUNTIME_ENVIRONMENT_H_
 
+#include "ChannelHandle.h"
 #include "ChannelProxy.h"
 #include "ChannelProxy.h"
 #include "Logger.h"
 #include "TimerManager.h"
 #include "Configuration.h"
+#include "Interceptor.h"
+#include "MessagePool.h"
+#include "SessionRegistry.h"
 #include "SharedPointerDict.h"
 
 /**
@@ -81,6 +85,16 @@ namespace FreeAX25 {
 			 */
 			Environment& operator=(Environment&& other) = delete;
 
+			/**
+			 * Apply the settings of the loaded configuration to the
+			 * message pool and the channel statistics. Call once after
+			 * the configuration has been read and before the first plugin
+			 * is started, otherwise their defaults stay in effect. The
+			 * timer service is not included, the host still calls
+			 * timerManager.init() itself.
+			 */
+			void init();
+
 			/**
 			 * Logger service.
 			 */
@@ -96,6 +110,26 @@ namespace FreeAX25 {
 			 */
 			Configuration configuration{};
 
+			/**
+			 * Pool of message objects.
+			 */
+			MessagePool messagePool{};
+
+			/**
+			 * Table of channels for ChannelHandles.
+			 */
+			HandleTable channelHandles{};
+
+			/**
+			 * Registry of interceptor factories.
+			 */
+			InterceptorRegistry interceptors{};
+
+			/**
+			 * Index of all live sessions.
+			 */
+			SessionRegistry sessions{};
+
 			/**
 			 * Server proxies.
 			 */
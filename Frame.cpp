@@ -0,0 +1,116 @@
+/*
+    Project FreeAX25_Runtime
+    Copyright (C) 2015  tania@df9ry.de
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Frame.h"
+
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+
+namespace FreeAX25 {
+	namespace Runtime {
+
+		const size_t Frame::DEFAULT_HEADROOM;
+		const size_t Frame::DEFAULT_TAILROOM;
+
+		Frame::Frame(const uint8_t* data, size_t size,
+				size_t headroom, size_t tailroom):
+			m_buffer{make_shared<FrameBuffer>(headroom + size + tailroom, headroom, size)},
+			m_offset{headroom},
+			m_size{size}
+		{
+			if (size > 0) memcpy(m_buffer->m_data.get() + headroom, data, size);
+		}
+
+		size_t Frame::headroom() const
+		{
+			if (!m_buffer) return 0;
+			return (m_buffer->m_front.load() == m_offset) ? m_offset : 0;
+		}
+
+		size_t Frame::tailroom() const
+		{
+			if (!m_buffer) return 0;
+			size_t end = m_offset + m_size;
+			return (m_buffer->m_back.load() == end) ? m_buffer->m_capacity - end : 0;
+		}
+
+		Frame Frame::prepend(const uint8_t* header, size_t size) const
+		{
+			if (m_buffer && (size <= m_offset)) {
+				// Claim the headroom. This fails if another frame did it before:
+				size_t front = m_offset;
+				if (m_buffer->m_front.compare_exchange_strong(front, m_offset - size)) {
+					memcpy(m_buffer->m_data.get() + m_offset - size, header, size);
+					return Frame(m_buffer, m_offset - size, m_size + size);
+				}
+			}
+			Frame result{allocate(size + m_size)};
+			uint8_t* p = result.m_buffer->m_data.get() + result.m_offset;
+			memcpy(p, header, size);
+			if (m_size > 0) memcpy(p + size, data(), m_size);
+			return result;
+		}
+
+		Frame Frame::append(const uint8_t* trailer, size_t size) const
+		{
+			size_t end = m_offset + m_size;
+			if (m_buffer && (size <= m_buffer->m_capacity - end)) {
+				// Claim the tailroom. This fails if another frame did it before:
+				size_t back = end;
+				if (m_buffer->m_back.compare_exchange_strong(back, end + size)) {
+					memcpy(m_buffer->m_data.get() + end, trailer, size);
+					return Frame(m_buffer, m_offset, m_size + size);
+				}
+			}
+			Frame result{allocate(m_size + size)};
+			uint8_t* p = result.m_buffer->m_data.get() + result.m_offset;
+			if (m_size > 0) memcpy(p, data(), m_size);
+			memcpy(p + m_size, trailer, size);
+			return result;
+		}
+
+		Frame Frame::allocate(size_t size)
+		{
+			return Frame(make_shared<FrameBuffer>(
+					DEFAULT_HEADROOM + size + DEFAULT_TAILROOM, DEFAULT_HEADROOM, size),
+					DEFAULT_HEADROOM, size);
+		}
+
+		Frame Frame::removeFront(size_t size) const
+		{
+			if (size > m_size) throw out_of_range("Frame too short");
+			return Frame(m_buffer, m_offset + size, m_size - size);
+		}
+
+		Frame Frame::removeBack(size_t size) const
+		{
+			if (size > m_size) throw out_of_range("Frame too short");
+			return Frame(m_buffer, m_offset, m_size - size);
+		}
+
+		Frame Frame::slice(size_t offset, size_t size) const
+		{
+			if ((offset > m_size) || (size > m_size - offset))
+				throw out_of_range("Frame too short");
+			return Frame(m_buffer, m_offset + offset, size);
+		}
+
+	} /* end namespace Runtime */
+} /* end namespace FreeAX25 */
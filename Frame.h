@@ -0,0 +1,209 @@
+/*
+    Project FreeAX25_Runtime
+    Copyright (C) 2015  tania@df9ry.de
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file */
+
+#ifndef FREEAX25_RUNTIME_FRAME_H_
+#define FREEAX25_RUNTIME_FRAME_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace FreeAX25 {
+	namespace Runtime {
+
+		/**
+		 * Storage of a Frame. Shared by all frames that are views into it.
+		 */
+		class FrameBuffer {
+			friend class Frame;
+
+		public:
+			/**
+			 * Constructor.
+			 * @param capacity Number of bytes to allocate.
+			 * @param offset Offset of the first used byte.
+			 * @param size Number of used bytes.
+			 */
+			FrameBuffer(size_t capacity, size_t offset, size_t size):
+				m_data{new uint8_t[capacity]}, m_capacity{capacity},
+				m_front{offset}, m_back{offset + size} {}
+
+			/**
+			 * You can not copy a FrameBuffer.
+			 * @param other Not used.
+			 */
+			FrameBuffer(const FrameBuffer& other) = delete;
+
+			/**
+			 * You can not assign a FrameBuffer.
+			 * @param other Not used.
+			 * @return Not used.
+			 */
+			FrameBuffer& operator=(const FrameBuffer& other) = delete;
+
+			/**
+			 * Destructor.
+			 */
+			~FrameBuffer() {}
+
+		private:
+			std::unique_ptr<uint8_t[]> m_data;
+			const size_t               m_capacity;
+			std::atomic<size_t>        m_front; // Lowest byte ever handed out
+			std::atomic<size_t>        m_back;  // Highest byte ever handed out + 1
+		};
+
+		/**
+		 * Immutable binary message. A Frame is a cheap to copy, reference
+		 * counted view into a FrameBuffer. The buffer keeps headroom and
+		 * tailroom, so that protocol layers can add and remove headers and
+		 * trailers without copying the payload. Bytes that are visible to
+		 * any Frame are never changed.
+		 */
+		class Frame {
+		public:
+			/**
+			 * Default headroom for new frames. Fits an AX.25 header with
+			 * eight digipeaters.
+			 */
+			static const size_t DEFAULT_HEADROOM = 80;
+
+			/**
+			 * Default tailroom for new frames.
+			 */
+			static const size_t DEFAULT_TAILROOM = 16;
+
+			/**
+			 * Default constructor. Creates an empty frame.
+			 */
+			Frame() {}
+
+			/**
+			 * Constructor. Copies the data into a new buffer.
+			 * @param data Data to copy.
+			 * @param size Number of bytes to copy.
+			 * @param headroom Headroom to reserve.
+			 * @param tailroom Tailroom to reserve.
+			 */
+			Frame(const uint8_t* data, size_t size,
+					size_t headroom = DEFAULT_HEADROOM,
+					size_t tailroom = DEFAULT_TAILROOM);
+
+			/**
+			 * Test if the frame is set.
+			 */
+			explicit operator bool() const noexcept { return m_buffer != nullptr; }
+
+			/**
+			 * Get the payload.
+			 * @return Pointer to the first byte.
+			 */
+			const uint8_t* data() const {
+				return m_buffer ? m_buffer->m_data.get() + m_offset : nullptr;
+			}
+
+			/**
+			 * Get payload size.
+			 * @return Number of bytes.
+			 */
+			size_t size() const { return m_size; }
+
+			/**
+			 * Test if the frame has no payload.
+			 * @return If the frame is empty.
+			 */
+			bool empty() const { return m_size == 0; }
+
+			/**
+			 * Get a payload byte.
+			 * @param i Index of the byte.
+			 * @return Byte value.
+			 */
+			uint8_t operator[](size_t i) const { return data()[i]; }
+
+			/**
+			 * Get the headroom that can be used without copying.
+			 * @return Usable headroom.
+			 */
+			size_t headroom() const;
+
+			/**
+			 * Get the tailroom that can be used without copying.
+			 * @return Usable tailroom.
+			 */
+			size_t tailroom() const;
+
+			/**
+			 * Add a header. Does not copy the payload if there is enough
+			 * headroom.
+			 * @param header Header bytes.
+			 * @param size Number of header bytes.
+			 * @return Frame with the header in front.
+			 */
+			Frame prepend(const uint8_t* header, size_t size) const;
+
+			/**
+			 * Add a trailer. Does not copy the payload if there is enough
+			 * tailroom.
+			 * @param trailer Trailer bytes.
+			 * @param size Number of trailer bytes.
+			 * @return Frame with the trailer at the end.
+			 */
+			Frame append(const uint8_t* trailer, size_t size) const;
+
+			/**
+			 * Remove a header. Never copies.
+			 * @param size Number of bytes to remove.
+			 * @return Frame without the header.
+			 */
+			Frame removeFront(size_t size) const;
+
+			/**
+			 * Remove a trailer. Never copies.
+			 * @param size Number of bytes to remove.
+			 * @return Frame without the trailer.
+			 */
+			Frame removeBack(size_t size) const;
+
+			/**
+			 * Get a part of the frame. Never copies.
+			 * @param offset Offset of the first byte.
+			 * @param size Number of bytes.
+			 * @return Frame with the selected part.
+			 */
+			Frame slice(size_t offset, size_t size) const;
+
+		private:
+			Frame(const std::shared_ptr<FrameBuffer>& buffer,
+					size_t offset, size_t size):
+				m_buffer{buffer}, m_offset{offset}, m_size{size} {}
+
+			static Frame allocate(size_t size);
+
+			std::shared_ptr<FrameBuffer> m_buffer{};
+			size_t                       m_offset{0};
+			size_t                       m_size{0};
+		};
+
+	} /* end namespace Runtime */
+} /* end namespace FreeAX25 */
+
+#endif /* FREEAX25_RUNTIME_FRAME_H_ */
@@ -0,0 +1,78 @@
+/*
+    Project FreeAX25_Runtime
+    Copyright (C) 2015  tania@df9ry.de
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Interceptor.h"
+
+#include <stdexcept>
+
+using namespace std;
+
+namespace FreeAX25 {
+	namespace Runtime {
+
+		InterceptorRegistry::InterceptorRegistry()
+		{
+		}
+
+		InterceptorRegistry::~InterceptorRegistry()
+		{
+		}
+
+		void InterceptorRegistry::add(const string& name, InterceptorFactory factory)
+		{
+			if (!factory) throw invalid_argument("No factory for interceptor " + name);
+			lock_guard<mutex> lock(m_mutex);
+			if (!m_factories.insert(make_pair(name, move(factory))).second)
+				throw runtime_error("Interceptor already registered: " + name);
+		}
+
+		unique_ptr<Interceptor> InterceptorRegistry::create(const string& name) const
+		{
+			InterceptorFactory factory{};
+			{
+				lock_guard<mutex> lock(m_mutex);
+				auto it = m_factories.find(name);
+				if (it == m_factories.end())
+					throw runtime_error("Unknown interceptor: " + name);
+				factory = it->second;
+			}
+			unique_ptr<Interceptor> interceptor{factory()};
+			if (!interceptor) throw runtime_error("Interceptor not created: " + name);
+			return interceptor;
+		}
+
+		vector<unique_ptr<Interceptor>> InterceptorRegistry::createList(
+				const string& names) const
+		{
+			vector<unique_ptr<Interceptor>> result{};
+			size_t start = 0;
+			while (start <= names.size()) {
+				size_t end = names.find(',', start);
+				if (end == string::npos) end = names.size();
+				// Trim blanks around the name:
+				size_t first = names.find_first_not_of(" \t", start);
+				size_t last = names.find_last_not_of(" \t", end - 1);
+				if ((first != string::npos) && (first < end) && (last >= first))
+					result.push_back(create(names.substr(first, last - first + 1)));
+				start = end + 1;
+			} // end while //
+			return result;
+		}
+
+	} /* end namespace Runtime */
+} /* end namespace FreeAX25 */
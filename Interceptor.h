@@ -0,0 +1,149 @@
+/*
+    Project FreeAX25_Runtime
+    Copyright (C) 2015  tania@df9ry.de
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file */
+
+#ifndef FREEAX25_RUNTIME_INTERCEPTOR_H_
+#define FREEAX25_RUNTIME_INTERCEPTOR_H_
+
+#include "ChannelProxy.h"
+#include "Frame.h"
+
+#include <JsonXValue.h>
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace FreeAX25 {
+	namespace Runtime {
+
+		/**
+		 * Filter on the send path of a Channel. It runs in place on the
+		 * sender's thread, before the message leaves the channel, and can
+		 * inspect, rewrite or drop it. Interceptors of a channel run in
+		 * the order they were added.
+		 */
+		class Interceptor {
+		public:
+			/**
+			 * Destructor.
+			 */
+			virtual ~Interceptor() {}
+
+			/**
+			 * Called for every message that is sent.
+			 * @param message The message, can be modified or replaced.
+			 * @param priority Message priority, can be modified.
+			 * @return false to drop the message.
+			 */
+			virtual bool onSend(std::unique_ptr<JsonX::Object>& message,
+					MessagePriority& priority) { return true; }
+
+			/**
+			 * Called for every frame that is sent.
+			 * @param frame The frame, can be replaced.
+			 * @param priority Message priority, can be modified.
+			 * @return false to drop the frame.
+			 */
+			virtual bool onSendFrame(Frame& frame,
+					MessagePriority& priority) { return true; }
+		};
+
+		/**
+		 * Function that creates an interceptor.
+		 */
+		typedef std::function<std::unique_ptr<Interceptor>()> InterceptorFactory;
+
+		/**
+		 * Named interceptor factories. Plugins register their interceptors
+		 * here, so channels can be given interceptors by name through
+		 * the configuration.
+		 */
+		class InterceptorRegistry {
+		public:
+			/**
+			 * Constructor.
+			 */
+			InterceptorRegistry();
+
+			/**
+			 * You can not copy an InterceptorRegistry.
+			 * @param other Not used.
+			 */
+			InterceptorRegistry(const InterceptorRegistry& other) = delete;
+
+			/**
+			 * You can not move an InterceptorRegistry.
+			 * @param other Not used.
+			 */
+			InterceptorRegistry(InterceptorRegistry&& other) = delete;
+
+			/**
+			 * You can not assign an InterceptorRegistry.
+			 * @param other Not used.
+			 * @return Not used.
+			 */
+			InterceptorRegistry& operator=(const InterceptorRegistry& other) = delete;
+
+			/**
+			 * You can not assign an InterceptorRegistry.
+			 * @param other Not used.
+			 * @return Not used.
+			 */
+			InterceptorRegistry& operator=(InterceptorRegistry&& other) = delete;
+
+			/**
+			 * Destructor.
+			 */
+			~InterceptorRegistry();
+
+			/**
+			 * Register an interceptor factory.
+			 * @param name Name of the interceptor.
+			 * @param factory Function that creates it.
+			 */
+			void add(const std::string& name, InterceptorFactory factory);
+
+			/**
+			 * Create an interceptor.
+			 * @param name Name of the interceptor.
+			 * @return New interceptor.
+			 */
+			std::unique_ptr<Interceptor> create(const std::string& name) const;
+
+			/**
+			 * Create interceptors from a comma separated list of names.
+			 * @param names List of names, e.g. "checksum,counter".
+			 * @return New interceptors, in the order of the list.
+			 */
+			std::vector<std::unique_ptr<Interceptor>> createList(
+					const std::string& names) const;
+
+		private:
+			mutable std::mutex                        m_mutex{};
+			std::map<std::string, InterceptorFactory> m_factories{};
+		};
+
+	} /* end namespace Runtime */
+} /* end namespace FreeAX25 */
+
+#endif /* FREEAX25_RUNTIME_INTERCEPTOR_H_ */
@@ -0,0 +1,86 @@
+/*
+    Project FreeAX25_Runtime
+    Copyright (C) 2015  tania@df9ry.de
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Mailbox.h"
+
+using namespace std;
+
+namespace FreeAX25 {
+	namespace Runtime {
+
+		Mailbox::Mailbox(size_t capacity, bool singleProducer)
+		{
+			if (singleProducer) {
+				m_priorityRing.reset(new RingBuffer<Envelope>(capacity));
+				m_routineRing.reset(new RingBuffer<Envelope>(capacity));
+			}
+			else {
+				m_priorityQueue.reset(new MessageQueue<Envelope>(capacity));
+				m_routineQueue.reset(new MessageQueue<Envelope>(capacity));
+			}
+		}
+
+		Mailbox::~Mailbox()
+		{
+		}
+
+		bool Mailbox::push(Envelope& envelope, MessagePriority priority)
+		{
+			bool ok;
+			if (m_priorityRing)
+				ok = (priority == MessagePriority::PRIORITY) ?
+						m_priorityRing->push(envelope) : m_routineRing->push(envelope);
+			else
+				ok = (priority == MessagePriority::PRIORITY) ?
+						m_priorityQueue->push(envelope) : m_routineQueue->push(envelope);
+			if (ok) m_wakeup.signal();
+			return ok;
+		}
+
+		bool Mailbox::pop(Envelope& envelope, MessagePriority& priority)
+		{
+			if (m_priorityRing ? m_priorityRing->pop(envelope) : m_priorityQueue->pop(envelope)) {
+				priority = MessagePriority::PRIORITY;
+				return true;
+			}
+			if (m_routineRing ? m_routineRing->pop(envelope) : m_routineQueue->pop(envelope)) {
+				priority = MessagePriority::ROUTINE;
+				return true;
+			}
+			return false;
+		}
+
+		bool Mailbox::empty() const
+		{
+			if (m_priorityRing)
+				return m_priorityRing->empty() && m_routineRing->empty();
+			return m_priorityQueue->empty() && m_routineQueue->empty();
+		}
+
+		bool Mailbox::wait(int timeout)
+		{
+			m_wakeup.arm();
+			if (!empty()) {
+				m_wakeup.disarm();
+				return true;
+			}
+			return m_wakeup.wait(timeout) || !empty();
+		}
+
+	} /* end namespace Runtime */
+} /* end namespace FreeAX25 */
@@ -0,0 +1,157 @@
+/*
+    Project FreeAX25_Runtime
+    Copyright (C) 2015  tania@df9ry.de
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file */
+
+#ifndef FREEAX25_RUNTIME_MAILBOX_H_
+#define FREEAX25_RUNTIME_MAILBOX_H_
+
+#include "ChannelProxy.h"
+#include "Frame.h"
+#include "MessageQueue.h"
+#include "RingBuffer.h"
+#include "Wakeup.h"
+
+#include <JsonXValue.h>
+
+#include <memory>
+
+namespace FreeAX25 {
+	namespace Runtime {
+
+		/**
+		 * What an Envelope carries.
+		 */
+		enum class EnvelopeKind {
+			EMPTY,   //!< Nothing, skipped on delivery
+			MESSAGE, //!< A message
+			FRAME    //!< A Frame
+		};
+
+		/**
+		 * Entry of a Mailbox. Carries either a message or a Frame.
+		 */
+		struct Envelope {
+			/**
+			 * What this envelope carries.
+			 */
+			EnvelopeKind                   kind{EnvelopeKind::EMPTY};
+
+			/**
+			 * Message, if this is not a Frame.
+			 */
+			std::unique_ptr<JsonX::Object> message{};
+
+			/**
+			 * Frame, if this is not a message.
+			 */
+			Frame                          frame{};
+		};
+
+		/**
+		 * Inbound queue of a Channel in queued delivery mode. There is one
+		 * lane for every MessagePriority. PRIORITY messages are always
+		 * delivered before waiting ROUTINE messages. The lanes are either
+		 * many producer queues or, if there is only one sender thread,
+		 * cheaper single producer rings.
+		 */
+		class Mailbox {
+		public:
+			/**
+			 * Constructor.
+			 * @param capacity Capacity of each lane.
+			 * @param singleProducer If only one thread will ever push.
+			 */
+			Mailbox(size_t capacity, bool singleProducer = false);
+
+			/**
+			 * You can not copy a Mailbox.
+			 * @param other Not used.
+			 */
+			Mailbox(const Mailbox& other) = delete;
+
+			/**
+			 * You can not move a Mailbox.
+			 * @param other Not used.
+			 */
+			Mailbox(Mailbox&& other) = delete;
+
+			/**
+			 * You can not assign a Mailbox.
+			 * @param other Not used.
+			 * @return Not used.
+			 */
+			Mailbox& operator=(const Mailbox& other) = delete;
+
+			/**
+			 * You can not assign a Mailbox.
+			 * @param other Not used.
+			 * @return Not used.
+			 */
+			Mailbox& operator=(Mailbox&& other) = delete;
+
+			/**
+			 * Destructor.
+			 */
+			~Mailbox();
+
+			/**
+			 * Put an envelope into the lane for its priority. Can be called
+			 * from any thread.
+			 * @param envelope Envelope to put. It is moved only on success.
+			 * @param priority Message priority.
+			 * @return false if the lane is full.
+			 */
+			bool push(Envelope& envelope, MessagePriority priority);
+
+			/**
+			 * Take the next envelope. Must only be called from the receiver
+			 * thread.
+			 * @param envelope Receives the envelope.
+			 * @param priority Receives the message priority.
+			 * @return false if both lanes are empty.
+			 */
+			bool pop(Envelope& envelope, MessagePriority& priority);
+
+			/**
+			 * Test if both lanes are empty. Only reliable on the receiver
+			 * thread.
+			 * @return If the mailbox is empty.
+			 */
+			bool empty() const;
+
+			/**
+			 * Wait until the mailbox is not empty. Must only be called from
+			 * the receiver thread.
+			 * @param timeout Timeout in milliseconds, -1 for infinite.
+			 * @return false on timeout.
+			 */
+			bool wait(int timeout);
+
+		private:
+			std::unique_ptr<MessageQueue<Envelope>> m_priorityQueue{};
+			std::unique_ptr<MessageQueue<Envelope>> m_routineQueue{};
+			std::unique_ptr<RingBuffer<Envelope>>   m_priorityRing{};
+			std::unique_ptr<RingBuffer<Envelope>>   m_routineRing{};
+			Wakeup                                  m_wakeup{};
+		};
+
+	} /* end namespace Runtime */
+} /* end namespace FreeAX25 */
+
+#endif /* FREEAX25_RUNTIME_MAILBOX_H_ */
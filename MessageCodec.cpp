@@ -0,0 +1,312 @@
+/*
+    Project FreeAX25_Runtime
+    Copyright (C) 2015  tania@df9ry.de
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "MessageCodec.h"
+
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+namespace FreeAX25 {
+	namespace Runtime {
+
+		const size_t MessageCodec::MAX_DEPTH;
+
+		// CBOR major types:
+		static const uint8_t MAJOR_UNSIGNED = 0;
+		static const uint8_t MAJOR_NEGATIVE = 1;
+		static const uint8_t MAJOR_TEXT     = 3;
+		static const uint8_t MAJOR_ARRAY    = 4;
+		static const uint8_t MAJOR_MAP      = 5;
+		static const uint8_t MAJOR_SIMPLE   = 7;
+
+		// Simple values and floats (major type 7):
+		static const uint8_t CBOR_FALSE   = 0xf4;
+		static const uint8_t CBOR_TRUE    = 0xf5;
+		static const uint8_t CBOR_NULL    = 0xf6;
+		static const uint8_t CBOR_FLOAT32 = 0xfa;
+		static const uint8_t CBOR_FLOAT64 = 0xfb;
+
+		namespace {
+
+		/**
+		 * Writes into the buffer, or only counts if there is none. Once
+		 * the buffer is exhausted nothing more is written.
+		 */
+		class Writer {
+		public:
+			Writer(uint8_t* buffer, size_t size):
+				m_buffer{buffer}, m_size{size} {}
+
+			size_t position() const { return m_position; }
+			bool overflow() const { return m_position > m_size; }
+
+			void put(const void* data, size_t n) {
+				if (m_buffer && (n <= m_size) && (m_position <= m_size - n))
+					memcpy(m_buffer + m_position, data, n);
+				m_position += n;
+			}
+
+			void putByte(uint8_t b) {
+				if (m_buffer && (m_position < m_size)) m_buffer[m_position] = b;
+				++m_position;
+			}
+
+			void putHead(uint8_t major, uint64_t value) {
+				uint8_t head[9];
+				size_t n;
+				major <<= 5;
+				if (value < 24) {
+					head[0] = major | (uint8_t)value;
+					n = 1;
+				}
+				else if (value <= 0xff) {
+					head[0] = major | 24;
+					n = 2;
+				}
+				else if (value <= 0xffff) {
+					head[0] = major | 25;
+					n = 3;
+				}
+				else if (value <= 0xffffffffULL) {
+					head[0] = major | 26;
+					n = 5;
+				}
+				else {
+					head[0] = major | 27;
+					n = 9;
+				}
+				for (size_t i = n - 1; i > 0; --i, value >>= 8)
+					head[i] = (uint8_t)value;
+				put(head, n);
+			}
+
+			void putText(const string& text) {
+				putHead(MAJOR_TEXT, text.size());
+				put(text.data(), text.size());
+			}
+
+			void putNumber(double value) {
+				bool integral = (value == floor(value)) && (fabs(value) < 9.2e18);
+				// -0.0 stays a double, so that its sign survives:
+				if (integral && !((value == 0.0) && signbit(value))) {
+					int64_t i = (int64_t)value;
+					if (i >= 0)
+						putHead(MAJOR_UNSIGNED, (uint64_t)i);
+					else
+						putHead(MAJOR_NEGATIVE, (uint64_t)(-1 - i));
+					return;
+				}
+				uint64_t bits;
+				memcpy(&bits, &value, sizeof(bits));
+				uint8_t data[9];
+				data[0] = CBOR_FLOAT64;
+				for (size_t i = 8; i > 0; --i, bits >>= 8)
+					data[i] = (uint8_t)bits;
+				put(data, sizeof(data));
+			}
+
+			void putObject(const JsonX::Object& object) {
+				putHead(MAJOR_MAP, object.size());
+				for (const auto& member : object) {
+					putText(member.first);
+					putValue(member.second.get());
+				} // end for //
+			}
+
+			void putValue(const JsonX::Value* value) {
+				if (!value) {
+					putByte(CBOR_NULL);
+					return;
+				}
+				if (const JsonX::Object* object = dynamic_cast<const JsonX::Object*>(value)) {
+					putObject(*object);
+				}
+				else if (const JsonX::String* text = dynamic_cast<const JsonX::String*>(value)) {
+					putText(text->getValue());
+				}
+				else if (const JsonX::Number* number = dynamic_cast<const JsonX::Number*>(value)) {
+					putNumber(number->getValue());
+				}
+				else if (const JsonX::Array* array = dynamic_cast<const JsonX::Array*>(value)) {
+					putHead(MAJOR_ARRAY, array->size());
+					for (const auto& element : *array) putValue(element.get());
+				}
+				else if (const JsonX::Bool* flag = dynamic_cast<const JsonX::Bool*>(value)) {
+					putByte(flag->getValue() ? CBOR_TRUE : CBOR_FALSE);
+				}
+				else {
+					putByte(CBOR_NULL);
+				}
+			}
+
+		private:
+			uint8_t* m_buffer;
+			size_t   m_size;
+			size_t   m_position{0};
+		};
+
+		/**
+		 * Reads and validates. Every failure throws.
+		 */
+		class Reader {
+		public:
+			Reader(const uint8_t* data, size_t size):
+				m_data{data}, m_end{data + size} {}
+
+			bool atEnd() const { return m_data == m_end; }
+
+			static void fail() {
+				throw runtime_error("Invalid message encoding");
+			}
+
+			uint8_t getByte() {
+				if (m_data == m_end) fail();
+				return *m_data++;
+			}
+
+			uint64_t getUInt(size_t n) {
+				if ((size_t)(m_end - m_data) < n) fail();
+				uint64_t value = 0;
+				for (size_t i = 0; i < n; ++i) value = (value << 8) | *m_data++;
+				return value;
+			}
+
+			uint64_t getArgument(uint8_t initial) {
+				uint8_t info = initial & 0x1f;
+				if (info < 24) return info;
+				switch (info) {
+				case 24: return getUInt(1);
+				case 25: return getUInt(2);
+				case 26: return getUInt(4);
+				case 27: return getUInt(8);
+				default: fail(); // Reserved or indefinite length
+				} // end switch //
+				return 0;
+			}
+
+			// Every element needs at least one byte, so a count larger
+			// than the rest of the input is wrong:
+			size_t getCount(uint8_t initial) {
+				uint64_t count = getArgument(initial);
+				if (count > (uint64_t)(m_end - m_data)) fail();
+				return (size_t)count;
+			}
+
+			string getText(uint8_t initial) {
+				if ((initial >> 5) != MAJOR_TEXT) fail();
+				size_t n = getCount(initial);
+				string text(reinterpret_cast<const char*>(m_data), n);
+				m_data += n;
+				return text;
+			}
+
+			unique_ptr<JsonX::Object> getObject(uint8_t initial, size_t depth) {
+				if (depth > MessageCodec::MAX_DEPTH) fail();
+				size_t n = getCount(initial);
+				unique_ptr<JsonX::Object> object{JsonX::Object::make()};
+				for (size_t i = 0; i < n; ++i) {
+					string key{getText(getByte())};
+					object->set(key, getValue(depth));
+				} // end for //
+				return object;
+			}
+
+			unique_ptr<JsonX::Value> getValue(size_t depth) {
+				uint8_t initial = getByte();
+				switch (initial >> 5) {
+				case MAJOR_UNSIGNED:
+					return JsonX::Number::make((double)getArgument(initial));
+				case MAJOR_NEGATIVE:
+					return JsonX::Number::make(-1.0 - (double)getArgument(initial));
+				case MAJOR_TEXT:
+					return JsonX::String::make(getText(initial));
+				case MAJOR_ARRAY: {
+					if (depth + 1 > MessageCodec::MAX_DEPTH) fail();
+					size_t n = getCount(initial);
+					unique_ptr<JsonX::Array> array{JsonX::Array::make()};
+					for (size_t i = 0; i < n; ++i) array->append(getValue(depth + 1));
+					return move(array);
+				}
+				case MAJOR_MAP:
+					return getObject(initial, depth + 1);
+				case MAJOR_SIMPLE:
+					switch (initial) {
+					case CBOR_FALSE: return JsonX::Bool::make(false);
+					case CBOR_TRUE:  return JsonX::Bool::make(true);
+					case CBOR_NULL:  return JsonX::Null::make();
+					case CBOR_FLOAT32: {
+						uint32_t bits = (uint32_t)getUInt(4);
+						float value;
+						memcpy(&value, &bits, sizeof(value));
+						return JsonX::Number::make(value);
+					}
+					case CBOR_FLOAT64: {
+						uint64_t bits = getUInt(8);
+						double value;
+						memcpy(&value, &bits, sizeof(value));
+						return JsonX::Number::make(value);
+					}
+					default:
+						fail();
+					} // end switch //
+					break;
+				default:
+					fail(); // Byte strings and tags are not used
+				} // end switch //
+				return nullptr;
+			}
+
+		private:
+			const uint8_t* m_data;
+			const uint8_t* m_end;
+		};
+
+		} /* end anonymous namespace */
+
+		size_t MessageCodec::encodedSize(const JsonX::Object& message)
+		{
+			Writer writer{nullptr, 0};
+			writer.putObject(message);
+			return writer.position();
+		}
+
+		size_t MessageCodec::encode(const JsonX::Object& message,
+				uint8_t* buffer, size_t size)
+		{
+			Writer writer{buffer, size};
+			writer.putObject(message);
+			return writer.overflow() ? 0 : writer.position();
+		}
+
+		unique_ptr<JsonX::Object> MessageCodec::decode(
+				const uint8_t* data, size_t size)
+		{
+			Reader reader{data, size};
+			uint8_t initial = reader.getByte();
+			if ((initial >> 5) != MAJOR_MAP) Reader::fail();
+			unique_ptr<JsonX::Object> message{reader.getObject(initial, 1)};
+			if (!reader.atEnd()) Reader::fail();
+			return message;
+		}
+
+	} /* end namespace Runtime */
+} /* end namespace FreeAX25 */
@@ -0,0 +1,80 @@
+/*
+    Project FreeAX25_Runtime
+    Copyright (C) 2015  tania@df9ry.de
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file */
+
+#ifndef FREEAX25_RUNTIME_MESSAGECODEC_H_
+#define FREEAX25_RUNTIME_MESSAGECODEC_H_
+
+#include <JsonXValue.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace FreeAX25 {
+	namespace Runtime {
+
+		/**
+		 * Compact binary encoding of channel messages, for everything
+		 * that leaves the process. The format is a subset of CBOR
+		 * (RFC 7049): maps with text keys, arrays, text strings, integers,
+		 * doubles, booleans and null. Numbers with an integral value are
+		 * written as integers, all others, including -0.0, as doubles.
+		 * Only definite lengths are used.
+		 */
+		class MessageCodec {
+		public:
+			/**
+			 * Maximal nesting of maps and arrays the decoder accepts.
+			 */
+			static const size_t MAX_DEPTH = 64;
+
+			/**
+			 * Get the size of the encoding of a message.
+			 * @param message The message.
+			 * @return Size in bytes.
+			 */
+			static size_t encodedSize(const JsonX::Object& message);
+
+			/**
+			 * Encode a message into a buffer. Nothing is allocated.
+			 * @param message The message.
+			 * @param buffer Buffer to write to.
+			 * @param size Size of the buffer.
+			 * @return Number of bytes written, 0 if the buffer is too small.
+			 */
+			static size_t encode(const JsonX::Object& message,
+					uint8_t* buffer, size_t size);
+
+			/**
+			 * Decode a message. The input is fully validated, anything that
+			 * is truncated, malformed, too deeply nested or followed by
+			 * extra bytes is rejected.
+			 * @param data Encoded message.
+			 * @param size Size of the encoded message.
+			 * @return The message.
+			 */
+			static std::unique_ptr<JsonX::Object> decode(
+					const uint8_t* data, size_t size);
+		};
+
+	} /* end namespace Runtime */
+} /* end namespace FreeAX25 */
+
+#endif /* FREEAX25_RUNTIME_MESSAGECODEC_H_ */
@@ -0,0 +1,65 @@
+/*
+    Project FreeAX25_Runtime
+    Copyright (C) 2015  tania@df9ry.de
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "MessagePool.h"
+#include "Environment.h"
+#include "Setting.h"
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace FreeAX25 {
+	namespace Runtime {
+
+		// Free list of the current thread. Deleted on thread exit:
+		static thread_local vector<unique_ptr<JsonX::Object>> freeList{};
+
+		MessagePool::MessagePool() {
+		}
+
+		MessagePool::~MessagePool() {
+		}
+
+		void MessagePool::init() {
+			int limit = Setting::asIntValue(env().configuration.settings,
+					"messagePool", 64);
+			m_limit = (limit > 0) ? limit : 0;
+			INF("Set message pool size to " + to_string(limit));
+		}
+
+		std::unique_ptr<JsonX::Object> MessagePool::acquire() {
+			if (freeList.empty()) return JsonX::Object::make();
+			unique_ptr<JsonX::Object> object{move(freeList.back())};
+			freeList.pop_back();
+			return object;
+		}
+
+		void MessagePool::release(std::unique_ptr<JsonX::Object>&& object) {
+			if (!object) return;
+			if (freeList.size() >= m_limit.load(memory_order_relaxed)) {
+				object.reset();
+				return;
+			}
+			object->clear();
+			freeList.push_back(move(object));
+		}
+
+	} /* end namespace Runtime */
+} /* end namespace FreeAX25 */
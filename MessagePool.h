@@ -0,0 +1,109 @@
+/*
+    Project FreeAX25_Runtime
+    Copyright (C) 2015  tania@df9ry.de
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file */
+
+#ifndef FREEAX25_RUNTIME_MESSAGEPOOL_H_
+#define FREEAX25_RUNTIME_MESSAGEPOOL_H_
+
+#include <JsonXValue.h>
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+namespace FreeAX25 {
+	namespace Runtime {
+
+		/**
+		 * Pool of empty JsonX::Object shells for the channel hot path. Every
+		 * thread has its own free list, so acquire() and release() never
+		 * lock. Channels give back messages and parameters that the
+		 * receiving handler did not take over.
+		 */
+		class MessagePool {
+		public:
+			/**
+			 * Constructor.
+			 */
+			MessagePool();
+
+			/**
+			 * You can not copy a MessagePool.
+			 * @param other Not used.
+			 */
+			MessagePool(const MessagePool& other) = delete;
+
+			/**
+			 * You can not move a MessagePool.
+			 * @param other Not used.
+			 */
+			MessagePool(MessagePool&& other) = delete;
+
+			/**
+			 * You can not assign a MessagePool.
+			 * @param other Not used.
+			 * @return Not used.
+			 */
+			MessagePool& operator=(const MessagePool& other) = delete;
+
+			/**
+			 * You can not assign a MessagePool.
+			 * @param other Not used.
+			 * @return Not used.
+			 */
+			MessagePool& operator=(MessagePool&& other) = delete;
+
+			/**
+			 * Destructor.
+			 */
+			~MessagePool();
+
+			/**
+			 * Initialize the MessagePool.
+			 */
+			void init();
+
+			/**
+			 * Get an empty object. It is taken from the free list of the
+			 * calling thread, if there is one.
+			 * @return Empty object.
+			 */
+			std::unique_ptr<JsonX::Object> acquire();
+
+			/**
+			 * Give an object back. It is cleared and put into the free
+			 * list of the calling thread, or deleted if that list is full.
+			 * @param object Object to give back. May be empty.
+			 */
+			void release(std::unique_ptr<JsonX::Object>&& object);
+
+			/**
+			 * Set the maximal number of objects kept per thread.
+			 * @param limit Maximal number of objects, 0 disables the pool.
+			 */
+			void setLimit(size_t limit) { m_limit = limit; }
+
+		private:
+			std::atomic<size_t> m_limit{64};
+		};
+
+	} /* end namespace Runtime */
+} /* end namespace FreeAX25 */
+
+#endif /* FREEAX25_RUNTIME_MESSAGEPOOL_H_ */
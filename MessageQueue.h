@@ -0,0 +1,166 @@
+/*
+    Project FreeAX25_Runtime
+    Copyright (C) 2015  tania@df9ry.de
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file */
+
+#ifndef FREEAX25_RUNTIME_MESSAGEQUEUE_H_
+#define FREEAX25_RUNTIME_MESSAGEQUEUE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace FreeAX25 {
+	namespace Runtime {
+
+		/**
+		 * Bounded lock free queue for many producers and a single consumer.
+		 * Every cell carries a sequence number that tells producers and the
+		 * consumer whether the cell is free or filled, so no locks are needed.
+		 */
+		template <typename T>
+		class MessageQueue {
+		public:
+			/**
+			 * Constructor.
+			 * @param capacity Capacity of the queue. Rounded up to the next
+			 *                 power of two.
+			 */
+			MessageQueue(size_t capacity):
+				m_mask{roundUp(capacity) - 1},
+				m_cells{new Cell[m_mask + 1]}
+			{
+				for (size_t i = 0; i <= m_mask; ++i)
+					m_cells[i].sequence.store(i, std::memory_order_relaxed);
+			}
+
+			/**
+			 * You can not copy a MessageQueue.
+			 * @param other Not used.
+			 */
+			MessageQueue(const MessageQueue& other) = delete;
+
+			/**
+			 * You can not move a MessageQueue.
+			 * @param other Not used.
+			 */
+			MessageQueue(MessageQueue&& other) = delete;
+
+			/**
+			 * You can not assign a MessageQueue.
+			 * @param other Not used.
+			 * @return Not used.
+			 */
+			MessageQueue& operator=(const MessageQueue& other) = delete;
+
+			/**
+			 * You can not assign a MessageQueue.
+			 * @param other Not used.
+			 * @return Not used.
+			 */
+			MessageQueue& operator=(MessageQueue&& other) = delete;
+
+			/**
+			 * Destructor.
+			 */
+			~MessageQueue() {}
+
+			/**
+			 * Append an item. Can be called from any thread.
+			 * @param item Item to append. It is moved only on success.
+			 * @return false if the queue is full.
+			 */
+			bool push(T& item) {
+				size_t pos = m_tail.load(std::memory_order_relaxed);
+				for (;;) {
+					Cell& cell = m_cells[pos & m_mask];
+					size_t seq = cell.sequence.load(std::memory_order_acquire);
+					intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+					if (diff == 0) {
+						if (m_tail.compare_exchange_weak(pos, pos + 1,
+								std::memory_order_relaxed))
+						{
+							cell.data = std::move(item);
+							cell.sequence.store(pos + 1, std::memory_order_release);
+							return true;
+						}
+					}
+					else if (diff < 0) {
+						return false; // Full
+					}
+					else {
+						pos = m_tail.load(std::memory_order_relaxed);
+					}
+				} // end for //
+			}
+
+			/**
+			 * Remove the oldest item. Must only be called from the consumer
+			 * thread.
+			 * @param item Receives the item.
+			 * @return false if the queue is empty.
+			 */
+			bool pop(T& item) {
+				Cell& cell = m_cells[m_head & m_mask];
+				size_t seq = cell.sequence.load(std::memory_order_acquire);
+				if (seq != m_head + 1) return false; // Empty
+				item = std::move(cell.data);
+				cell.sequence.store(m_head + m_mask + 1, std::memory_order_release);
+				++m_head;
+				return true;
+			}
+
+			/**
+			 * Test if the queue is empty. Only reliable on the consumer thread.
+			 * @return If the queue is empty.
+			 */
+			bool empty() const {
+				return m_cells[m_head & m_mask].sequence.load(
+						std::memory_order_acquire) != m_head + 1;
+			}
+
+			/**
+			 * Get the capacity of the queue.
+			 * @return Capacity.
+			 */
+			size_t capacity() const { return m_mask + 1; }
+
+		private:
+			struct Cell {
+				std::atomic<size_t> sequence{0};
+				T                   data{};
+			};
+
+			static size_t roundUp(size_t n) {
+				size_t result = 2;
+				while (result < n) result <<= 1;
+				return result;
+			}
+
+			const size_t            m_mask;
+			std::unique_ptr<Cell[]> m_cells;
+			std::atomic<size_t>     m_tail{0};
+			size_t                  m_head{0};
+		};
+
+	} /* end namespace Runtime */
+} /* end namespace FreeAX25 */
+
+#endif /* FREEAX25_RUNTIME_MESSAGEQUEUE_H_ */
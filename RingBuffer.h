@@ -0,0 +1,156 @@
+/*
+    Project FreeAX25_Runtime
+    Copyright (C) 2015  tania@df9ry.de
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file */
+
+#ifndef FREEAX25_RUNTIME_RINGBUFFER_H_
+#define FREEAX25_RUNTIME_RINGBUFFER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+namespace FreeAX25 {
+	namespace Runtime {
+
+		/**
+		 * Bounded lock free ring for exactly one producer thread and one
+		 * consumer thread. Producer and consumer indices live on cache lines
+		 * of their own, and each side caches the other side's index, so the
+		 * hot path usually touches no shared cache line at all.
+		 */
+		template <typename T>
+		class RingBuffer {
+		public:
+			/**
+			 * Constructor.
+			 * @param capacity Capacity of the ring. Rounded up to the next
+			 *                 power of two.
+			 */
+			RingBuffer(size_t capacity):
+				m_mask{roundUp(capacity) - 1},
+				m_slots{new T[m_mask + 1]}
+			{
+			}
+
+			/**
+			 * You can not copy a RingBuffer.
+			 * @param other Not used.
+			 */
+			RingBuffer(const RingBuffer& other) = delete;
+
+			/**
+			 * You can not move a RingBuffer.
+			 * @param other Not used.
+			 */
+			RingBuffer(RingBuffer&& other) = delete;
+
+			/**
+			 * You can not assign a RingBuffer.
+			 * @param other Not used.
+			 * @return Not used.
+			 */
+			RingBuffer& operator=(const RingBuffer& other) = delete;
+
+			/**
+			 * You can not assign a RingBuffer.
+			 * @param other Not used.
+			 * @return Not used.
+			 */
+			RingBuffer& operator=(RingBuffer&& other) = delete;
+
+			/**
+			 * Destructor.
+			 */
+			~RingBuffer() {}
+
+			/**
+			 * Append an item. Must only be called from the producer thread.
+			 * @param item Item to append. It is moved only on success.
+			 * @return false if the ring is full.
+			 */
+			bool push(T& item) {
+				size_t tail = m_tail.load(std::memory_order_relaxed);
+				if (tail - m_headCache > m_mask) {
+					m_headCache = m_head.load(std::memory_order_acquire);
+					if (tail - m_headCache > m_mask) return false; // Full
+				}
+				m_slots[tail & m_mask] = std::move(item);
+				m_tail.store(tail + 1, std::memory_order_release);
+				return true;
+			}
+
+			/**
+			 * Remove the oldest item. Must only be called from the consumer
+			 * thread.
+			 * @param item Receives the item.
+			 * @return false if the ring is empty.
+			 */
+			bool pop(T& item) {
+				size_t head = m_head.load(std::memory_order_relaxed);
+				if (head == m_tailCache) {
+					m_tailCache = m_tail.load(std::memory_order_acquire);
+					if (head == m_tailCache) return false; // Empty
+				}
+				item = std::move(m_slots[head & m_mask]);
+				m_head.store(head + 1, std::memory_order_release);
+				return true;
+			}
+
+			/**
+			 * Test if the ring is empty. Only reliable on the consumer thread.
+			 * @return If the ring is empty.
+			 */
+			bool empty() const {
+				return m_head.load(std::memory_order_relaxed) ==
+						m_tail.load(std::memory_order_acquire);
+			}
+
+			/**
+			 * Get the capacity of the ring.
+			 * @return Capacity.
+			 */
+			size_t capacity() const { return m_mask + 1; }
+
+		private:
+			static const size_t CACHE_LINE = 64;
+
+			static size_t roundUp(size_t n) {
+				size_t result = 2;
+				while (result < n) result <<= 1;
+				return result;
+			}
+
+			const size_t         m_mask;
+			std::unique_ptr<T[]> m_slots;
+			char                 m_pad0[CACHE_LINE];
+			// Producer side:
+			std::atomic<size_t>  m_tail{0};
+			size_t               m_headCache{0};
+			char                 m_pad1[CACHE_LINE];
+			// Consumer side:
+			std::atomic<size_t>  m_head{0};
+			size_t               m_tailCache{0};
+			char                 m_pad2[CACHE_LINE];
+		};
+
+	} /* end namespace Runtime */
+} /* end namespace FreeAX25 */
+
+#endif /* FREEAX25_RUNTIME_RINGBUFFER_H_ */
@@ -0,0 +1,50 @@
+/*
+    Project FreeAX25_Runtime
+    Copyright (C) 2015  tania@df9ry.de
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "SessionBase.h"
+#include "Environment.h"
+
+namespace FreeAX25 {
+	namespace Runtime {
+
+		void SessionBase::publish()
+		{
+			if (!m_weak.expired()) return; // Published already
+			env().sessions.add(m_pointer);
+		}
+
+		void SessionBase::publishFromConstructor()
+		{
+			try {
+				publish();
+			}
+			catch (...) {
+				// No destructor runs for a failed constructor, so m_pointer
+				// must not delete the object:
+				m_destroying = true;
+				throw;
+			}
+		}
+
+		void SessionBase::deregisterSession()
+		{
+			env().sessions.remove(this);
+		}
+
+	} /* end namespace Runtime */
+} /* end namespace FreeAX25 */
@@ -24,9 +24,10 @@
 #include "JsonXValue.h"
 #include "Channel.h"
 #include "ChannelProxy.h"
-#include "UUID.h"
+#include "SessionId.h"
 
 #include <memory>
+#include <mutex>
 #include <string>
 
 namespace FreeAX25 {
@@ -34,9 +35,15 @@ namespace FreeAX25 {
 		class Channel;
 
 		/**
-		 * All session objects have to derive from this class
+		 * All session objects have to derive from this class. Every
+		 * session is registered in env().sessions by the SessionBase
+		 * constructor, so a lookup on another thread can find it before
+		 * the derived constructor has finished. Sessions that must not be
+		 * seen half built pass Publish::LATER and call publish() at the
+		 * end of their own constructor.
 		 */
 		class SessionBase {
+			friend class SessionRegistry;
 
 		public:
 
@@ -69,21 +76,81 @@ namespace FreeAX25 {
 			/**
 			 * Destructor.
 			 */
-			virtual ~SessionBase() {}
+			virtual ~SessionBase() {
+				m_destroying = true;
+				deregisterSession();
+			}
+
+			/**
+			 * Get session id as text. It is formatted on the first call.
+			 * @return Session id.
+			 */
+			const std::string& id() const {
+				std::call_once(m_textFlag, [this]() { m_text = m_id.toString(); });
+				return m_text;
+			}
 
 			/**
 			 * Get session id.
 			 * @return Session id.
 			 */
-			const std::string& id() const { return m_id; }
+			const SessionId& sessionId() const { return m_id; }
 
 		protected:
 
+			/**
+			 * When a session is made visible in env().sessions.
+			 */
+			enum class Publish {
+				NOW,  //!< In the SessionBase constructor, the default.
+				LATER //!< When the derived class calls publish().
+			};
+
+			/**
+			 * Constructor. The session gets a new random id.
+			 * @param when When to register the session.
+			 */
+			SessionBase(Publish when = Publish::NOW):
+				m_pointer{std::shared_ptr<SessionBase>(this, &SessionBase::destroy)},
+				m_id{SessionId::random()}
+			{
+				if (when == Publish::NOW) publishFromConstructor();
+			}
+
 			/**
 			 * Constructor.
+			 * @param id Session id.
+			 * @param when When to register the session.
+			 */
+			SessionBase(const SessionId& id, Publish when = Publish::NOW):
+				m_pointer{std::shared_ptr<SessionBase>(this, &SessionBase::destroy)},
+				m_id{id}
+			{
+				if (when == Publish::NOW) publishFromConstructor();
+			}
+
+			/**
+			 * Constructor for a session with a name instead of a random
+			 * id. The name is kept as the text form of the id.
+			 * @param id Session name.
+			 * @param when When to register the session.
 			 */
-			SessionBase(const std::string& id = FreeAX25::Runtime::newUUID()):
-				m_pointer{std::shared_ptr<SessionBase>(this)}, m_id{id} {}
+			SessionBase(const std::string& id, Publish when = Publish::NOW):
+				m_pointer{std::shared_ptr<SessionBase>(this, &SessionBase::destroy)},
+				m_id{SessionId::fromString(id)}
+			{
+				std::call_once(m_textFlag, [this, &id]() { m_text = id; });
+				if (when == Publish::NOW) publishFromConstructor();
+			}
+
+			/**
+			 * Make the session visible in env().sessions. Sessions
+			 * constructed with Publish::LATER call it at the end of the
+			 * constructor of the most derived class, so that nobody finds
+			 * a session that is still under construction. Calling it
+			 * again does nothing.
+			 */
+			void publish();
 
 			/**
 			 * Set the remote proxy for a channel.
@@ -92,6 +159,7 @@ namespace FreeAX25 {
 			 */
 			void setRemote(Channel& channel, ChannelProxy& proxy) {
 				channel.m_remote = proxy;
+				channel.initCredits();
 			}
 
 			/**
@@ -99,9 +167,20 @@ namespace FreeAX25 {
 			 */
 			virtual void reset()
 			{
+				deregisterSession();
 				m_pointer.reset();
 			}
 
+		private:
+			// Set by the destructor. A constructor that throws destroys
+			// m_pointer with the object, then it must not delete again:
+			bool                         m_destroying{false};
+
+			static void destroy(SessionBase* session) {
+				if (!session->m_destroying) delete session;
+			}
+
+		protected:
 			/**
 			 * Shared pointer to self. Used to hold object in memory even if no
 			 * other object references it. Reset this pointer to allow deletion.
@@ -111,7 +190,15 @@ namespace FreeAX25 {
 			/**
 			 * ID of this object.
 			 */
-			const std::string            m_id;
+			const SessionId              m_id;
+
+		private:
+			mutable std::string          m_text{};
+			mutable std::once_flag       m_textFlag{};
+			std::weak_ptr<SessionBase>   m_weak{}; // For SessionRegistry
+
+			void publishFromConstructor();
+			void deregisterSession();
 		};
 
 	} /* end namespace Runtime */
@@ -0,0 +1,104 @@
+/*
+    Project FreeAX25_Runtime
+    Copyright (C) 2015  tania@df9ry.de
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "SessionId.h"
+#include "UUID.h"
+
+using namespace std;
+
+namespace FreeAX25 {
+	namespace Runtime {
+
+		const size_t SessionId::TEXT_LENGTH;
+
+		static inline int hexValue(char c)
+		{
+			if ((c >= '0') && (c <= '9')) return c - '0';
+			if ((c >= 'a') && (c <= 'f')) return c - 'a' + 10;
+			if ((c >= 'A') && (c <= 'F')) return c - 'A' + 10;
+			return -1;
+		}
+
+		static inline bool isDash(size_t i)
+		{
+			return (i == 8) || (i == 13) || (i == 18) || (i == 23);
+		}
+
+		SessionId SessionId::random()
+		{
+			uint8_t uuid[UUID_SIZE];
+			newUUID(uuid);
+			uint64_t hi = 0, lo = 0;
+			for (size_t i = 0; i < 8; ++i) hi = (hi << 8) | uuid[i];
+			for (size_t i = 8; i < 16; ++i) lo = (lo << 8) | uuid[i];
+			return SessionId(hi, lo);
+		}
+
+		bool SessionId::parse(const string& text, SessionId& id)
+		{
+			if (text.size() != TEXT_LENGTH) return false;
+			uint64_t word[2] = {0, 0};
+			size_t digit = 0;
+			for (size_t i = 0; i < TEXT_LENGTH; ++i) {
+				if (isDash(i)) {
+					if (text[i] != '-') return false;
+					continue;
+				}
+				int v = hexValue(text[i]);
+				if (v < 0) return false;
+				word[digit / 16] = (word[digit / 16] << 4) | (uint64_t)v;
+				++digit;
+			} // end for //
+			id = SessionId(word[0], word[1]);
+			return true;
+		}
+
+		SessionId SessionId::fromString(const string& text)
+		{
+			SessionId id;
+			if (parse(text, id)) return id;
+			// Two FNV-1a hashes with different offsets:
+			uint64_t hi = 14695981039346656037ULL;
+			uint64_t lo = 0x6c62272e07bb0142ULL;
+			for (unsigned char c : text) {
+				hi = (hi ^ c) * 1099511628211ULL;
+				lo = (lo ^ c) * 1099511628211ULL;
+			}
+			lo ^= hi >> 32;
+			return SessionId(hi, lo);
+		}
+
+		void SessionId::format(char* buffer) const
+		{
+			uint8_t uuid[UUID_SIZE];
+			for (size_t i = 0; i < 8; ++i) {
+				uuid[i] = (uint8_t)(m_hi >> (56 - 8 * i));
+				uuid[i + 8] = (uint8_t)(m_lo >> (56 - 8 * i));
+			} // end for //
+			formatUUID(uuid, buffer);
+		}
+
+		string SessionId::toString() const
+		{
+			char buffer[TEXT_LENGTH + 1];
+			format(buffer);
+			return string(buffer, TEXT_LENGTH);
+		}
+
+	} /* end namespace Runtime */
+} /* end namespace FreeAX25 */
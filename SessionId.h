@@ -0,0 +1,166 @@
+/*
+    Project FreeAX25_Runtime
+    Copyright (C) 2015  tania@df9ry.de
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file */
+
+#ifndef FREEAX25_RUNTIME_SESSIONID_H_
+#define FREEAX25_RUNTIME_SESSIONID_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace FreeAX25 {
+	namespace Runtime {
+
+		/**
+		 * 128 bit session id. It is a plain value, so creating, copying,
+		 * comparing and hashing it never allocates. Random ids are UUIDs
+		 * version 4 and are only formatted to text on request.
+		 */
+		class SessionId {
+		public:
+			/**
+			 * Length of the text form, without the terminating zero.
+			 */
+			static const size_t TEXT_LENGTH = 36;
+
+			/**
+			 * Default constructor. The nil id.
+			 */
+			SessionId() {}
+
+			/**
+			 * Constructor.
+			 * @param hi Upper 64 bits.
+			 * @param lo Lower 64 bits.
+			 */
+			SessionId(uint64_t hi, uint64_t lo): m_hi{hi}, m_lo{lo} {}
+
+			/**
+			 * Create a new random id.
+			 * @return New id.
+			 */
+			static SessionId random();
+
+			/**
+			 * Parse the text form "xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx".
+			 * @param text Text to parse.
+			 * @param id Receives the id.
+			 * @return false if the text is not a valid id.
+			 */
+			static bool parse(const std::string& text, SessionId& id);
+
+			/**
+			 * Get the id for a text. This is the parsed id if the text is
+			 * in UUID form, otherwise an id derived from a hash of the
+			 * text, for sessions with arbitrary names.
+			 * @param text The text.
+			 * @return The id.
+			 */
+			static SessionId fromString(const std::string& text);
+
+			/**
+			 * Write the text form. Nothing is allocated.
+			 * @param buffer Buffer for TEXT_LENGTH characters plus a
+			 *               terminating zero.
+			 */
+			void format(char* buffer) const;
+
+			/**
+			 * Get the text form.
+			 * @return Text form.
+			 */
+			std::string toString() const;
+
+			/**
+			 * Get the upper 64 bits.
+			 * @return Upper 64 bits.
+			 */
+			uint64_t hi() const { return m_hi; }
+
+			/**
+			 * Get the lower 64 bits.
+			 * @return Lower 64 bits.
+			 */
+			uint64_t lo() const { return m_lo; }
+
+			/**
+			 * Get a hash of the id.
+			 * @return Hash.
+			 */
+			uint64_t hash() const {
+				uint64_t h = m_hi ^ (m_lo * 0x9e3779b97f4a7c15ULL);
+				return h ^ (h >> 29);
+			}
+
+			/**
+			 * Test if this is the nil id.
+			 * @return false for the nil id.
+			 */
+			explicit operator bool() const noexcept { return (m_hi | m_lo) != 0; }
+
+			/**
+			 * Compare for equality.
+			 * @param other Id to compare with.
+			 * @return If both ids are the same.
+			 */
+			bool operator==(const SessionId& other) const {
+				return (m_hi == other.m_hi) && (m_lo == other.m_lo);
+			}
+
+			/**
+			 * Compare for inequality.
+			 * @param other Id to compare with.
+			 * @return If the ids differ.
+			 */
+			bool operator!=(const SessionId& other) const {
+				return !(*this == other);
+			}
+
+			/**
+			 * Order ids, upper 64 bits first, e.g. for std::map.
+			 * @param other Id to compare with.
+			 * @return If this id sorts before the other one.
+			 */
+			bool operator<(const SessionId& other) const {
+				return (m_hi < other.m_hi) || ((m_hi == other.m_hi) && (m_lo < other.m_lo));
+			}
+
+		private:
+			uint64_t m_hi{0};
+			uint64_t m_lo{0};
+		};
+
+	} /* end namespace Runtime */
+} /* end namespace FreeAX25 */
+
+namespace std {
+	/**
+	 * Hash of a SessionId, for unordered containers.
+	 */
+	template <>
+	struct hash<FreeAX25::Runtime::SessionId> {
+		size_t operator()(const FreeAX25::Runtime::SessionId& id) const {
+			return (size_t)id.hash();
+		}
+	};
+}
+
+#endif /* FREEAX25_RUNTIME_SESSIONID_H_ */
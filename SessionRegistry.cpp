@@ -0,0 +1,233 @@
+/*
+    Project FreeAX25_Runtime
+    Copyright (C) 2015  tania@df9ry.de
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "SessionRegistry.h"
+#include "SessionBase.h"
+
+#include <limits>
+#include <thread>
+
+using namespace std;
+
+namespace FreeAX25 {
+	namespace Runtime {
+
+		static const size_t INITIAL_CAPACITY = 64;
+
+		// Any address that is never a real session:
+		static char tombstone;
+		SessionBase* const SessionRegistry::TOMBSTONE =
+				reinterpret_cast<SessionBase*>(&tombstone);
+
+		// Tells registries apart that were created at the same address:
+		static atomic<uint64_t> nextSerial{1};
+
+		SessionRegistry::Table::Table(size_t capacity):
+			mask{capacity - 1},
+			slots{new Slot[capacity]}
+		{
+		}
+
+		SessionRegistry::SessionRegistry():
+			m_serial{nextSerial++},
+			m_table{new Table(INITIAL_CAPACITY)}
+		{
+		}
+
+		SessionRegistry::~SessionRegistry()
+		{
+			delete m_table.load();
+			Reader* reader = m_readers.load();
+			while (reader) {
+				Reader* next = reader->next;
+				delete reader;
+				reader = next;
+			} // end while //
+		}
+
+		SessionRegistry::Reader* SessionRegistry::reader() const
+		{
+			// The reader slot of this thread, given back on thread exit:
+			struct Cache {
+				uint64_t serial{0};
+				Reader*  reader{nullptr};
+				~Cache() { if (reader) reader->used.store(false, memory_order_release); }
+			};
+			static thread_local Cache cache{};
+			if (cache.serial == m_serial) return cache.reader;
+			if (cache.reader) cache.reader->used.store(false, memory_order_release);
+			Reader* reader = m_readers.load(memory_order_acquire);
+			for (; reader; reader = reader->next) {
+				bool used = false;
+				if (!reader->used.load(memory_order_relaxed) &&
+						reader->used.compare_exchange_strong(used, true))
+					break;
+			} // end for //
+			if (!reader) {
+				reader = new Reader();
+				reader->used.store(true, memory_order_relaxed);
+				reader->next = m_readers.load(memory_order_relaxed);
+				while (!m_readers.compare_exchange_weak(reader->next, reader));
+			}
+			cache.serial = m_serial;
+			cache.reader = reader;
+			return reader;
+		}
+
+		SessionRegistry::Reader* SessionRegistry::enter() const
+		{
+			Reader* reader = this->reader();
+			// Publish the epoch before the table is read. A writer that
+			// misses it has unlinked its garbage before we look:
+			if (reader->depth++ == 0) reader->epoch.store(m_epoch.load());
+			return reader;
+		}
+
+		uint64_t SessionRegistry::oldestReader(const Reader* self) const
+		{
+			uint64_t oldest = numeric_limits<uint64_t>::max();
+			for (Reader* reader = m_readers.load(); reader; reader = reader->next) {
+				if (reader == self) continue;
+				uint64_t epoch = reader->epoch.load();
+				if ((epoch != 0) && (epoch < oldest)) oldest = epoch;
+			} // end for //
+			return oldest;
+		}
+
+		void SessionRegistry::add(const shared_ptr<SessionBase>& session)
+		{
+			if (!session) return;
+			session->m_weak = session;
+			lock_guard<mutex> lock(m_mutex);
+			Table* table = m_table.load();
+			// Keep at least half of the slots free:
+			if (2 * (m_used + 1) > table->mask + 1) {
+				grow();
+				table = m_table.load();
+			}
+			insert(*table, session->sessionId(), session.get());
+			++m_used;
+			m_size.fetch_add(1, memory_order_relaxed);
+		}
+
+		void SessionRegistry::insert(Table& table, const SessionId& id, SessionBase* session)
+		{
+			for (size_t i = id.hash() & table.mask; ; i = (i + 1) & table.mask) {
+				Slot& slot = table.slots[i];
+				if (!slot.session.load(memory_order_relaxed)) {
+					slot.id = id;
+					slot.session.store(session);
+					return;
+				}
+			} // end for //
+		}
+
+		void SessionRegistry::remove(const SessionBase* session)
+		{
+			if (!session) return;
+			uint64_t h = session->sessionId().hash();
+			uint64_t epoch = 0;
+			{ // begin protected block //
+				lock_guard<mutex> lock(m_mutex);
+				Table& table = *m_table.load();
+				for (size_t i = h & table.mask; ; i = (i + 1) & table.mask) {
+					SessionBase* entry = table.slots[i].session.load(memory_order_relaxed);
+					if (!entry) return; // Not registered
+					if (entry == session) {
+						table.slots[i].session.store(TOMBSTONE);
+						m_size.fetch_sub(1, memory_order_relaxed);
+						epoch = m_epoch.fetch_add(1);
+						reclaim();
+						break;
+					}
+				} // end for //
+			} // end protected block //
+			// Wait for lookups that might still see the session. A lookup
+			// on this thread is not waiting for us:
+			const Reader* self = reader();
+			while (oldestReader(self) <= epoch) this_thread::yield();
+		}
+
+		void SessionRegistry::grow()
+		{
+			Table* old = m_table.load();
+			size_t live = m_size.load(memory_order_relaxed) + 1;
+			size_t capacity = INITIAL_CAPACITY;
+			while (capacity < 4 * live) capacity <<= 1;
+			unique_ptr<Table> table{new Table(capacity)};
+			for (size_t i = 0; i <= old->mask; ++i) {
+				SessionBase* session = old->slots[i].session.load(memory_order_relaxed);
+				if (session && (session != TOMBSTONE))
+					insert(*table, old->slots[i].id, session);
+			} // end for //
+			m_table.store(table.release());
+			m_used = m_size.load(memory_order_relaxed);
+			m_retiredTables.push_back(RetiredTable{m_epoch.fetch_add(1),
+					unique_ptr<Table>(old)});
+			reclaim();
+		}
+
+		void SessionRegistry::reclaim()
+		{
+			// A table retired in an epoch before the oldest active reader is
+			// unreachable:
+			uint64_t oldest = oldestReader(nullptr);
+			size_t kept = 0;
+			for (auto& retired : m_retiredTables)
+				if (retired.epoch >= oldest)
+					m_retiredTables[kept++] = move(retired);
+			m_retiredTables.resize(kept);
+		}
+
+		shared_ptr<SessionBase> SessionRegistry::find(const SessionId& id) const
+		{
+			uint64_t h = id.hash();
+			ReadGuard guard(*this);
+			const Table& table = *m_table.load();
+			for (size_t i = h & table.mask; ; i = (i + 1) & table.mask) {
+				const Slot& slot = table.slots[i];
+				SessionBase* session = slot.session.load();
+				if (!session) return nullptr;
+				if ((session != TOMBSTONE) && (slot.id == id)) {
+					shared_ptr<SessionBase> result{session->m_weak.lock()};
+					if (result) return result;
+				}
+			} // end for //
+		}
+
+		void SessionRegistry::forEach(
+				const function<void(const shared_ptr<SessionBase>&)>& f) const
+		{
+			vector<shared_ptr<SessionBase>> sessions{};
+			{ // begin read block //
+				ReadGuard guard(*this);
+				const Table& table = *m_table.load();
+				sessions.reserve(m_size.load(memory_order_relaxed));
+				for (size_t i = 0; i <= table.mask; ++i) {
+					SessionBase* session = table.slots[i].session.load();
+					if (!session || (session == TOMBSTONE)) continue;
+					shared_ptr<SessionBase> locked{session->m_weak.lock()};
+					if (locked) sessions.push_back(move(locked));
+				} // end for //
+			} // end read block //
+			// f() may reset sessions, and remove() waits for readers:
+			for (auto& session : sessions) f(session);
+		}
+
+	} /* end namespace Runtime */
+} /* end namespace FreeAX25 */
@@ -0,0 +1,207 @@
+/*
+    Project FreeAX25_Runtime
+    Copyright (C) 2015  tania@df9ry.de
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file */
+
+#ifndef FREEAX25_RUNTIME_SESSIONREGISTRY_H_
+#define FREEAX25_RUNTIME_SESSIONREGISTRY_H_
+
+#include "SessionId.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace FreeAX25 {
+	namespace Runtime {
+
+		class SessionBase;
+
+		/**
+		 * Index of all live sessions by id. It is an open addressing hash
+		 * table on the SessionId, with linear probing, that keeps id and
+		 * session pointer right in its slots. Lookups and iteration never
+		 * lock. Registration and deregistration lock a mutex among
+		 * themselves only.
+		 *
+		 * Readers announce the epoch they started in, each thread in a
+		 * slot of its own. A replaced table is freed when every reader
+		 * active at the time of the replacement is done. remove() waits
+		 * the same way, so the session is not deleted under a reader. The
+		 * registry has to outlive all threads that use it.
+		 *
+		 * Sessions register themselves in the SessionBase constructor, or
+		 * in SessionBase::publish() if they asked to be published later,
+		 * and deregister in SessionBase::reset() or the destructor.
+		 */
+		class SessionRegistry {
+		public:
+			/**
+			 * Constructor.
+			 */
+			SessionRegistry();
+
+			/**
+			 * You can not copy a SessionRegistry.
+			 * @param other Not used.
+			 */
+			SessionRegistry(const SessionRegistry& other) = delete;
+
+			/**
+			 * You can not move a SessionRegistry.
+			 * @param other Not used.
+			 */
+			SessionRegistry(SessionRegistry&& other) = delete;
+
+			/**
+			 * You can not assign a SessionRegistry.
+			 * @param other Not used.
+			 * @return Not used.
+			 */
+			SessionRegistry& operator=(const SessionRegistry& other) = delete;
+
+			/**
+			 * You can not assign a SessionRegistry.
+			 * @param other Not used.
+			 * @return Not used.
+			 */
+			SessionRegistry& operator=(SessionRegistry&& other) = delete;
+
+			/**
+			 * Destructor.
+			 */
+			~SessionRegistry();
+
+			/**
+			 * Register a session.
+			 * @param session The session.
+			 */
+			void add(const std::shared_ptr<SessionBase>& session);
+
+			/**
+			 * Deregister a session. Does nothing if it is not registered.
+			 * Waits until no lookup that started before can still see it.
+			 * @param session The session.
+			 */
+			void remove(const SessionBase* session);
+
+			/**
+			 * Find a session by id. Lock free.
+			 * @param id Session id.
+			 * @return The session or nullptr.
+			 */
+			std::shared_ptr<SessionBase> find(const SessionId& id) const;
+
+			/**
+			 * Find a session by the text form of its id, or its name.
+			 * Lock free.
+			 * @param id Session id as text.
+			 * @return The session or nullptr.
+			 */
+			std::shared_ptr<SessionBase> find(const std::string& id) const {
+				return find(SessionId::fromString(id));
+			}
+
+			/**
+			 * Call a function for every live session. Lock free. Sessions
+			 * that are added or removed meanwhile may or may not be seen.
+			 * The function may reset sessions, it is called after the
+			 * sessions have been collected.
+			 * @param f Function to call.
+			 */
+			void forEach(const std::function<void(const std::shared_ptr<SessionBase>&)>& f) const;
+
+			/**
+			 * Get the number of registered sessions.
+			 * @return Number of sessions.
+			 */
+			size_t size() const { return m_size.load(std::memory_order_relaxed); }
+
+		private:
+			// A slot goes from empty to used to removed, never back. The id
+			// is written before the session is published:
+			struct Slot {
+				SessionId                 id{};
+				std::atomic<SessionBase*> session{nullptr};
+			};
+
+			struct Table {
+				Table(size_t capacity);
+				const size_t            mask;
+				std::unique_ptr<Slot[]> slots;
+			};
+
+			// Epoch of a reader thread, 0 while it does not read. Padded to
+			// a cache line of its own:
+			struct Reader {
+				std::atomic<uint64_t> epoch{0};
+				size_t                depth{0}; // Owner thread only
+				Reader*               next{nullptr};
+				std::atomic<bool>     used{false};
+				char                  pad[64 - sizeof(std::atomic<uint64_t>) -
+				                          sizeof(size_t) - sizeof(Reader*) -
+				                          sizeof(std::atomic<bool>)];
+			};
+
+			// Marks the calling thread as reader for its scope:
+			class ReadGuard {
+			public:
+				ReadGuard(const SessionRegistry& registry):
+					m_reader(registry.enter())
+				{}
+				~ReadGuard() {
+					if (--m_reader->depth == 0)
+						m_reader->epoch.store(0, std::memory_order_release);
+				}
+			private:
+				Reader* m_reader;
+			};
+
+			struct RetiredTable {
+				uint64_t               epoch;
+				std::unique_ptr<Table> table;
+			};
+
+			Reader* enter() const;
+			Reader* reader() const;
+			uint64_t oldestReader(const Reader* self) const;
+			void insert(Table& table, const SessionId& id, SessionBase* session);
+			void grow();
+			void reclaim();
+
+			static SessionBase* const TOMBSTONE;
+
+			const uint64_t                      m_serial;
+			std::atomic<Table*>                 m_table;
+			mutable std::atomic<uint64_t>       m_epoch{1};
+			mutable std::atomic<Reader*>        m_readers{nullptr};
+			std::atomic<size_t>                 m_size{0};
+			size_t                              m_used{0}; // Live and removed slots
+			std::mutex                          m_mutex{};
+			std::vector<RetiredTable>           m_retiredTables{};
+		};
+
+	} /* end namespace Runtime */
+} /* end namespace FreeAX25 */
+
+#endif /* FREEAX25_RUNTIME_SESSIONREGISTRY_H_ */
@@ -0,0 +1,411 @@
+/*
+    Project FreeAX25_Runtime
+    Copyright (C) 2015  tania@df9ry.de
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ShmTransport.h"
+#include "Environment.h"
+#include "MessageCodec.h"
+
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <new>
+#include <stdexcept>
+#include <string>
+
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace FreeAX25 {
+	namespace Runtime {
+
+		static const uint64_t SHM_MAGIC  = 0x4158323553484d31ULL; // "AX25SHM1"
+		static const size_t   CACHE_LINE = 64;
+
+		// Record types:
+		static const uint16_t REC_SKIP    = 0;
+		static const uint16_t REC_MESSAGE = 1;
+		static const uint16_t REC_FRAME   = 2;
+		static const uint16_t REC_OPEN    = 3;
+		static const uint16_t REC_CLOSE   = 4;
+
+		/**
+		 * Control block of one ring in the shared region.
+		 */
+		struct ShmRingHeader {
+			std::atomic<uint64_t> tail;     // Written by the producer
+			char                  pad0[CACHE_LINE - sizeof(std::atomic<uint64_t>)];
+			std::atomic<uint64_t> head;     // Written by the consumer
+			char                  pad1[CACHE_LINE - sizeof(std::atomic<uint64_t>)];
+			std::atomic<uint32_t> sequence; // Futex word
+			std::atomic<uint32_t> waiting;  // Consumer is waiting
+			char                  pad2[CACHE_LINE - 2 * sizeof(std::atomic<uint32_t>)];
+		};
+
+		/**
+		 * Control block of the shared region.
+		 */
+		struct ShmRegionHeader {
+			uint64_t magic;
+			uint64_t capacity;
+			char     pad[CACHE_LINE - 2 * sizeof(uint64_t)];
+			ShmRingHeader rings[2];
+		};
+
+		/**
+		 * Header of a record in a ring. Records are 8 byte aligned and
+		 * never wrap around the end of the ring.
+		 */
+		struct ShmRecordHeader {
+			uint32_t size;
+			uint16_t type;
+			uint16_t priority;
+		};
+
+		static inline size_t align8(size_t n) {
+			return (n + 7) & ~(size_t)7;
+		}
+
+		static void futexWait(std::atomic<uint32_t>* word, uint32_t expected, int timeout) {
+			struct timespec ts;
+			ts.tv_sec = timeout / 1000;
+			ts.tv_nsec = (timeout % 1000) * 1000000L;
+			syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT,
+					expected, (timeout < 0) ? nullptr : &ts, nullptr, 0);
+		}
+
+		static void futexWake(std::atomic<uint32_t>* word) {
+			syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE,
+					1, nullptr, nullptr, 0);
+		}
+
+		ShmTransport::ShmTransport(size_t capacity):
+			SessionBase(Publish::LATER), m_channel{m_pointer}
+		{
+			m_capacity = 64;
+			while (m_capacity < capacity) m_capacity <<= 1;
+			m_fd = memfd_create("FreeAX25", MFD_CLOEXEC);
+			if (m_fd < 0) throw runtime_error(
+				string("Unable to create shared memory! Cause: ") + strerror(errno));
+			map(true);
+			setup();
+			publish();
+		}
+
+		ShmTransport::ShmTransport(int fd):
+			SessionBase(Publish::LATER), m_channel{m_pointer}
+		{
+			m_fd = dup(fd);
+			if (m_fd < 0) throw runtime_error(
+				string("Unable to attach shared memory! Cause: ") + strerror(errno));
+			map(false);
+			setup();
+			publish();
+		}
+
+		ShmTransport::~ShmTransport()
+		{
+			stop();
+			if (m_region) munmap(m_region, m_regionSize);
+			if (m_fd >= 0) ::close(m_fd);
+		}
+
+		void ShmTransport::map(bool create)
+		{
+			if (create) {
+				m_regionSize = sizeof(ShmRegionHeader) + 2 * m_capacity;
+				if (ftruncate(m_fd, m_regionSize) < 0) throw runtime_error(
+					string("Unable to size shared memory! Cause: ") + strerror(errno));
+			}
+			else {
+				ShmRegionHeader header;
+				if (pread(m_fd, &header, sizeof(header), 0) != sizeof(header) ||
+						header.magic != SHM_MAGIC)
+					throw runtime_error("Invalid shared memory region");
+				// Do not trust the other process with the ring size:
+				struct stat st;
+				if (fstat(m_fd, &st) < 0) throw runtime_error(
+					string("Unable to inspect shared memory! Cause: ") + strerror(errno));
+				uint64_t capacity = header.capacity;
+				if ((capacity < CACHE_LINE) || ((capacity & (capacity - 1)) != 0) ||
+						(static_cast<uint64_t>(st.st_size) < sizeof(ShmRegionHeader)) ||
+						(capacity > (st.st_size - sizeof(ShmRegionHeader)) / 2))
+					throw runtime_error("Invalid shared memory region size");
+				m_capacity = capacity;
+				m_regionSize = sizeof(ShmRegionHeader) + 2 * m_capacity;
+			}
+			m_region = mmap(nullptr, m_regionSize, PROT_READ | PROT_WRITE,
+					MAP_SHARED, m_fd, 0);
+			if (m_region == MAP_FAILED) {
+				m_region = nullptr;
+				throw runtime_error(
+					string("Unable to map shared memory! Cause: ") + strerror(errno));
+			}
+			ShmRegionHeader* header = static_cast<ShmRegionHeader*>(m_region);
+			uint8_t* data = static_cast<uint8_t*>(m_region) + sizeof(ShmRegionHeader);
+			if (create) {
+				for (int i = 0; i < 2; ++i) {
+					ShmRingHeader* ring = new (&header->rings[i]) ShmRingHeader();
+					ring->tail.store(0);
+					ring->head.store(0);
+					ring->sequence.store(0);
+					ring->waiting.store(0);
+				}
+				header->capacity = m_capacity;
+				atomic_thread_fence(memory_order_release);
+				header->magic = SHM_MAGIC;
+			}
+			// The creator sends on ring 0, the attached side on ring 1:
+			int out = create ? 0 : 1;
+			m_out.header = &header->rings[out];
+			m_out.data = data + out * m_capacity;
+			m_in.header = &header->rings[1 - out];
+			m_in.data = data + (1 - out) * m_capacity;
+		}
+
+		void ShmTransport::setup()
+		{
+			m_channel.connectFunction = [this](ChannelProxy backlink,
+					std::unique_ptr<JsonX::Object>&& parameter)
+			{
+				lock_guard<mutex> lock(m_targetMutex);
+				if (m_target) throw runtime_error("Already connected");
+				m_target = backlink;
+				return m_channel.getLocalProxy();
+			};
+			m_channel.openFunction = [this](std::unique_ptr<JsonX::Object>&& parameter)
+			{
+				writeMessage(REC_OPEN, MessagePriority::PRIORITY, parameter);
+			};
+			m_channel.closeFunction = [this](std::unique_ptr<JsonX::Object>&& parameter)
+			{
+				writeMessage(REC_CLOSE, MessagePriority::PRIORITY, parameter);
+				lock_guard<mutex> lock(m_targetMutex);
+				m_target = ChannelProxy();
+			};
+			m_channel.receiveFunction = [this](std::unique_ptr<JsonX::Object>&& message,
+					MessagePriority priority)
+			{
+				writeMessage(REC_MESSAGE, priority, message);
+			};
+			m_channel.receiveFrameFunction = [this](const Frame& frame,
+					MessagePriority priority)
+			{
+				if (!write(REC_FRAME, priority, frame.data(), frame.size()))
+					throw runtime_error("Queue full");
+			};
+		}
+
+		void ShmTransport::writeMessage(uint16_t type, MessagePriority priority,
+				const std::unique_ptr<JsonX::Object>& message)
+		{
+			// Encode right into the ring:
+			size_t size = message ? MessageCodec::encodedSize(*message) : 0;
+			lock_guard<mutex> lock(m_writeMutex);
+			uint8_t* data = reserve(type, priority, size);
+			if (!data) throw runtime_error("Queue full");
+			if (size > 0) MessageCodec::encode(*message, data, size);
+			commit();
+		}
+
+		bool ShmTransport::write(uint16_t type, MessagePriority priority,
+				const uint8_t* data, size_t size)
+		{
+			lock_guard<mutex> lock(m_writeMutex);
+			uint8_t* target = reserve(type, priority, size);
+			if (!target) return false;
+			if (size > 0) memcpy(target, data, size);
+			commit();
+			return true;
+		}
+
+		uint8_t* ShmTransport::reserve(uint16_t type, MessagePriority priority,
+				size_t size)
+		{
+			size_t need = align8(sizeof(ShmRecordHeader) + size);
+			if (need > m_capacity) throw runtime_error("Message too large");
+			ShmRingHeader& ring = *m_out.header;
+			uint64_t tail = ring.tail.load(memory_order_relaxed);
+			uint64_t head = ring.head.load(memory_order_acquire);
+			size_t offset = tail & (m_capacity - 1);
+			size_t contiguous = m_capacity - offset;
+			size_t total = (contiguous < need) ? contiguous + need : need;
+			if (m_capacity - (tail - head) < total) return nullptr; // Full
+			if (contiguous < need) {
+				// Fill the rest of the ring, records never wrap around:
+				ShmRecordHeader* skip = reinterpret_cast<ShmRecordHeader*>(m_out.data + offset);
+				skip->size = contiguous - sizeof(ShmRecordHeader);
+				skip->type = REC_SKIP;
+				skip->priority = 0;
+				tail += contiguous;
+				offset = 0;
+			}
+			ShmRecordHeader* record = reinterpret_cast<ShmRecordHeader*>(m_out.data + offset);
+			record->size = size;
+			record->type = type;
+			record->priority = static_cast<uint16_t>(priority);
+			m_reserved = tail + need;
+			return reinterpret_cast<uint8_t*>(record + 1);
+		}
+
+		void ShmTransport::commit()
+		{
+			ShmRingHeader& ring = *m_out.header;
+			ring.tail.store(m_reserved, memory_order_release);
+			// Pairs with the check for data after setting waiting in wait():
+			atomic_thread_fence(memory_order_seq_cst);
+			if (ring.waiting.load(memory_order_relaxed)) {
+				ring.sequence.fetch_add(1);
+				futexWake(&ring.sequence);
+			}
+		}
+
+		size_t ShmTransport::poll(size_t max)
+		{
+			ShmRingHeader& ring = *m_in.header;
+			// A handler may stop or even destroy the transport:
+			shared_ptr<atomic<bool>> terminate{m_terminate};
+			size_t n = 0;
+			while ((max == 0) || (n < max)) {
+				uint64_t head = ring.head.load(memory_order_relaxed);
+				uint64_t tail = ring.tail.load(memory_order_acquire);
+				if (head == tail) break;
+				size_t offset = head & (m_capacity - 1);
+				const ShmRecordHeader* record =
+						reinterpret_cast<const ShmRecordHeader*>(m_in.data + offset);
+				size_t size = record->size;
+				size_t length = align8(sizeof(ShmRecordHeader) + size);
+				if ((length > m_capacity - offset) || (length > tail - head))
+					throw runtime_error("Corrupt shared memory ring");
+				uint16_t type = record->type;
+				MessagePriority priority = (record->priority ==
+						static_cast<uint16_t>(MessagePriority::PRIORITY)) ?
+						MessagePriority::PRIORITY : MessagePriority::ROUTINE;
+				const uint8_t* data = reinterpret_cast<const uint8_t*>(record + 1);
+				if (type == REC_SKIP) {
+					ring.head.store(head + length, memory_order_release);
+					continue;
+				}
+				// Read the record in place, then release it:
+				Frame frame{};
+				std::unique_ptr<JsonX::Object> message{};
+				if (type == REC_FRAME) {
+					frame = Frame(data, size);
+				}
+				else if (size > 0) {
+					try {
+						message = MessageCodec::decode(data, size);
+					}
+					catch (...) {
+						// Drop the record, so the next poll can go on:
+						ring.head.store(head + length, memory_order_release);
+						throw;
+					}
+				}
+				ring.head.store(head + length, memory_order_release);
+				if (!message && (type != REC_FRAME))
+					message = JsonX::Object::make();
+				++n;
+				ChannelProxy target{};
+				{
+					lock_guard<mutex> lock(m_targetMutex);
+					target = m_target;
+				}
+				if (!target) continue; // Nobody connected, drop it
+				switch (type) {
+				case REC_MESSAGE:
+					target.send(move(message), priority);
+					break;
+				case REC_FRAME:
+					target.sendFrame(frame, priority);
+					break;
+				case REC_OPEN:
+					target.open(move(message));
+					break;
+				case REC_CLOSE:
+					target.close(move(message));
+					break;
+				default:
+					throw runtime_error("Corrupt shared memory ring");
+				} // end switch //
+				if (terminate && *terminate) break;
+			} // end while //
+			return n;
+		}
+
+		bool ShmTransport::wait(int timeout)
+		{
+			ShmRingHeader& ring = *m_in.header;
+			uint32_t sequence = ring.sequence.load();
+			ring.waiting.store(1);
+			atomic_thread_fence(memory_order_seq_cst);
+			if (ring.head.load(memory_order_relaxed) == ring.tail.load(memory_order_acquire))
+				futexWait(&ring.sequence, sequence, timeout);
+			ring.waiting.store(0);
+			return ring.head.load(memory_order_relaxed) != ring.tail.load(memory_order_acquire);
+		}
+
+		void ShmTransport::start()
+		{
+			if (m_thread.joinable()) return;
+			// The thread keeps its own flag, stop() might be called by a
+			// handler that destroys the transport:
+			shared_ptr<atomic<bool>> terminate{make_shared<atomic<bool>>(false)};
+			m_terminate = terminate;
+			std::thread _t{[this, terminate]() {
+				while (!*terminate) {
+					try {
+						if (wait(100)) poll();
+					}
+					catch (const exception& ex) {
+						env().logError(
+								string("Shared memory transport with exception: ") +
+								ex.what());
+					}
+				} // end while //
+			}};
+			m_thread = std::move(_t);
+		}
+
+		void ShmTransport::stop()
+		{
+			if (m_terminate) *m_terminate = true;
+			if (!m_thread.joinable()) return;
+			if (m_thread.get_id() == this_thread::get_id())
+				m_thread.detach(); // Ends when the handler returns
+			else
+				m_thread.join();
+		}
+
+		void ShmTransport::reset()
+		{
+			stop();
+			{
+				lock_guard<mutex> lock(m_targetMutex);
+				m_target = ChannelProxy();
+			}
+			m_channel.reset();
+			SessionBase::reset(); // Might call delete!
+		}
+
+	} /* end namespace Runtime */
+} /* end namespace FreeAX25 */
@@ -0,0 +1,158 @@
+/*
+    Project FreeAX25_Runtime
+    Copyright (C) 2015  tania@df9ry.de
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file */
+
+#ifndef FREEAX25_RUNTIME_SHMTRANSPORT_H_
+#define FREEAX25_RUNTIME_SHMTRANSPORT_H_
+
+#include "Channel.h"
+#include "ChannelProxy.h"
+#include "Frame.h"
+#include "SessionBase.h"
+
+#include <JsonXValue.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace FreeAX25 {
+	namespace Runtime {
+
+		struct ShmRingHeader;
+
+		/**
+		 * Channel transport between two local processes over a shared
+		 * memory region (memfd). The region holds one single producer /
+		 * single consumer byte ring per direction. Local senders on
+		 * several threads are serialized before they write to the ring. Every message is written
+		 * once into the ring, in the binary MessageCodec format, and the
+		 * receiving side reads it in place.
+		 * Waiting uses a futex in the shared region.
+		 *
+		 * One process creates the transport, hands fd() to the other one
+		 * (by fork() or over a unix socket), and the other process attaches
+		 * to it. On each side a local channel connects to proxy(). Messages,
+		 * frames, open and close requests sent there go to the channel that
+		 * is connected on the other side. Control requests are not
+		 * forwarded.
+		 */
+		class ShmTransport: public SessionBase {
+		public:
+			/**
+			 * Create a new shared region.
+			 * @param capacity Capacity of each ring in bytes. Rounded up to
+			 *                 the next power of two.
+			 */
+			ShmTransport(size_t capacity);
+
+			/**
+			 * Attach to a shared region that was created in another process.
+			 * @param fd File descriptor of the region. It is duplicated.
+			 */
+			ShmTransport(int fd);
+
+			/**
+			 * Destructor.
+			 */
+			virtual ~ShmTransport();
+
+			/**
+			 * Get the file descriptor of the shared region.
+			 * @return File descriptor to hand over to the other process.
+			 */
+			int fd() const { return m_fd; }
+
+			/**
+			 * Get the proxy a local channel has to connect to.
+			 * @return ChannelProxy of the transport.
+			 */
+			ChannelProxy proxy() { return m_channel.getLocalProxy(); }
+
+			/**
+			 * Deliver messages that arrived from the other process to the
+			 * connected local channel. Must only be called from one thread.
+			 * @param max Maximal number of messages to deliver, 0 for all.
+			 * @return Number of messages delivered.
+			 */
+			size_t poll(size_t max = 0);
+
+			/**
+			 * Wait until something arrived from the other process.
+			 * @param timeout Timeout in milliseconds, -1 for infinite.
+			 * @return false on timeout.
+			 */
+			bool wait(int timeout = -1);
+
+			/**
+			 * Start a thread that calls wait() and poll() until stop().
+			 * Does nothing if the thread is already running.
+			 */
+			void start();
+
+			/**
+			 * Stop the thread started by start(). From a handler running
+			 * on that thread this does not wait, the thread ends as soon
+			 * as the handler returns. The handler may then also destroy
+			 * the transport.
+			 */
+			void stop();
+
+			/**
+			 * Stop the transport and release it. It is not usable after that.
+			 */
+			virtual void reset() override;
+
+		private:
+			struct Ring {
+				ShmRingHeader* header;
+				uint8_t*       data;
+			};
+
+			void map(bool create);
+			void setup();
+			bool write(uint16_t type, MessagePriority priority,
+					const uint8_t* data, size_t size);
+			uint8_t* reserve(uint16_t type, MessagePriority priority, size_t size);
+			void commit();
+			void writeMessage(uint16_t type, MessagePriority priority,
+					const std::unique_ptr<JsonX::Object>& message);
+
+			int                 m_fd{-1};
+			size_t              m_capacity{0};
+			void*               m_region{nullptr};
+			size_t              m_regionSize{0};
+			Ring                m_out{};
+			Ring                m_in{};
+			std::mutex          m_writeMutex{};
+			uint64_t            m_reserved{0};
+			Channel             m_channel;
+			std::mutex          m_targetMutex{};
+			ChannelProxy        m_target{};
+			std::thread         m_thread{};
+			std::shared_ptr<std::atomic<bool>> m_terminate{};
+		};
+
+	} /* end namespace Runtime */
+} /* end namespace FreeAX25 */
+
+#endif /* FREEAX25_RUNTIME_SHMTRANSPORT_H_ */
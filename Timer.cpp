@@ -18,6 +18,7 @@
 
 #include "Timer.h"
 #include "TimerManager.h"
+#include "TimerShard.h"
 #include "Environment.h"
 
 #include <cassert>
@@ -28,6 +29,24 @@ using namespace std::chrono;
 namespace FreeAX25 {
 	namespace Runtime {
 
+		/**
+		 * Round a deadline up to the largest power of two nanoseconds
+		 * that is not longer than slack.
+		 */
+		static steady_clock::time_point coalesce(
+				const steady_clock::time_point& deadline,
+				const steady_clock::duration& slack)
+		{
+			auto tolerance = duration_cast<nanoseconds>(slack).count();
+			if (tolerance < 2) return deadline;
+			int64_t granule = int64_t{1} << (63 - __builtin_clzll(tolerance));
+			int64_t t = duration_cast<nanoseconds>(
+					deadline.time_since_epoch()).count();
+			t = ((t + granule - 1) / granule) * granule;
+			return steady_clock::time_point{
+					duration_cast<steady_clock::duration>(nanoseconds{t})};
+		}
+
 		Timer::Timer(
 				const std::string& id,
 				const std::chrono::steady_clock::duration& d,
@@ -35,35 +54,121 @@ namespace FreeAX25 {
 			m_id{id},
 			m_stdDuration{d},
 			m_function{f},
-			m_iterator{env().timerManager.m_activeTimers.end()}
+			m_shard{&env().timerManager.shardForThread()},
+			m_iterator{m_shard.load()->m_activeTimers.end()},
+			m_dispatch{make_shared<Dispatch>()}
 		{
 			assert(f != nullptr);
+			// Spread the timers evenly over the workers:
+			static atomic<size_t> nextKey{0};
+			m_dispatch->key = nextKey++;
 		}
 
 		Timer::~Timer() {
-			lock_guard<mutex> lock(m_mutex);
-			if (m_running) _stop();
+			{
+				unique_lock<mutex> shardLock{_lockShard()};
+				lock_guard<mutex> lock(m_mutex);
+				if (m_running) _stop();
+				if (m_detached) {
+					_cancel();
+					return;
+				}
+			}
+			// Drop queued callbacks and wait for a running one:
+			m_dispatch->wait();
+		}
+
+		unique_lock<mutex> Timer::_lockShard() {
+			// setAffinity() might move the timer while we wait:
+			for (;;) {
+				TimerShard* shard = m_shard.load();
+				unique_lock<mutex> lock(shard->m_mutex);
+				if (m_shard.load() == shard) return lock;
+			} // end for //
 		}
 
 		void Timer::_start(const steady_clock::duration& d) {
 			//m_environment->logDebug("Start timer " + m_id);
-			// Lock the manager:
-			lock_guard<mutex> lock(env().timerManager.m_mutex);
-			assert(m_iterator == env().timerManager.m_activeTimers.end());
-			m_deadline = steady_clock::now() + d;
-			m_iterator = env().timerManager.m_activeTimers.insert(
-					pair<steady_clock::time_point, Timer&>(m_deadline, *this));
+			_cancel();
+			m_deadline = coalesce(steady_clock::now() + d, m_slack);
+			m_shard.load()->_insert(*this);
 			m_running = true;
 		}
 
 		void Timer::_stop() {
 			//m_environment->logDebug("Stop timer " + m_id);
-			// Lock the manager:
-			lock_guard<mutex> lock(env().timerManager.m_mutex);
 			m_running = false;
-			if (m_iterator == env().timerManager.m_activeTimers.end()) return;
-			env().timerManager.m_activeTimers.erase(m_iterator);
-			m_iterator = env().timerManager.m_activeTimers.end();
+			m_shard.load()->_erase(*this);
+		}
+
+		void Timer::setAffinity(size_t affinity) {
+			TimerShard* shard = &env().timerManager.shard(affinity);
+			for (;;) {
+				TimerShard* current = m_shard.load();
+				if (shard == current) return;
+				// Both shards first, then the timer:
+				std::lock(current->m_mutex, shard->m_mutex);
+				lock_guard<mutex> lock1(current->m_mutex, adopt_lock);
+				lock_guard<mutex> lock2(shard->m_mutex, adopt_lock);
+				if (m_shard.load() != current) continue;
+				lock_guard<mutex> lock3(m_mutex);
+				if (m_running) current->_erase(*this);
+				m_shard = shard;
+				m_iterator = shard->m_activeTimers.end();
+				if (m_running) shard->_insert(*this);
+				return;
+			} // end for //
+		}
+
+		uint64_t Timer::Dispatch::current() {
+			lock_guard<std::mutex> lock(mutex);
+			return generation;
+		}
+
+		void Timer::Dispatch::cancel() {
+			lock_guard<std::mutex> lock(mutex);
+			++generation;
+		}
+
+		void Timer::Dispatch::wait() {
+			unique_lock<std::mutex> lock(mutex);
+			++generation;
+			// A callback may destroy its own timer. Inline callbacks run
+			// on the timer thread and are not waited for, the destroying
+			// thread might hold a lock they need:
+			condition.wait(lock, [this] {
+				return !running || !dispatched ||
+						(thread == this_thread::get_id());
+			});
+		}
+
+		void Timer::Dispatch::run(uint64_t gen, const function<void()>& f,
+				bool dispatched)
+		{
+			{
+				lock_guard<std::mutex> lock(mutex);
+				// Stopped or restarted since the timer expired:
+				if (gen != generation) return;
+				running = true;
+				this->dispatched = dispatched;
+				thread = this_thread::get_id();
+			}
+			try {
+				f();
+			}
+			catch (...) {
+				{
+					lock_guard<std::mutex> lock(mutex);
+					running = false;
+				}
+				condition.notify_all();
+				throw;
+			}
+			{
+				lock_guard<std::mutex> lock(mutex);
+				running = false;
+			}
+			condition.notify_all();
 		}
 
 	} /* end namespace Runtime */
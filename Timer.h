@@ -25,17 +25,32 @@
 #include <mutex>
 #include <map>
 #include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
 
 namespace FreeAX25 {
 	namespace Runtime {
 
 		class TimerManager;
+		class TimerShard;
+		class TimerWheel;
+
+		/**
+		 * Executor for timer callbacks. It gets the job to run and has to
+		 * run it exactly once, e.g. on the thread of a session.
+		 */
+		using TimerExecutor = std::function<void(std::function<void()>)>;
 
 		/**
 		 * Single timer.
 		 */
 		class Timer {
 			friend class TimerManager;
+			friend class TimerShard;
+			friend class TimerWheel;
 
 		public:
 			/**
@@ -64,7 +79,13 @@ namespace FreeAX25 {
 			Timer(Timer&& other) = delete;
 
 			/**
-			 * Destructor. Stops timer, if necessary.
+			 * Destructor. Stops timer, if necessary. Callbacks that are
+			 * queued but not started yet are dropped. If the callback was
+			 * dispatched to a worker or executor and is running right now
+			 * the destructor blocks until it returns, so do not destroy a
+			 * timer while holding a lock its callback takes. Callbacks run
+			 * by the timer thread itself (no workers, no executor) are not
+			 * waited for. See detach().
 			 */
 			~Timer();
 
@@ -87,6 +108,7 @@ namespace FreeAX25 {
 			 * @param d The duration this timer should run
 			 */
 			void start(const std::chrono::steady_clock::duration& d) {
+				std::unique_lock<std::mutex> shardLock{_lockShard()};
 				std::lock_guard<std::mutex> lock(m_mutex);
 				if (m_running) _stop();
 				_start(d);
@@ -103,8 +125,25 @@ namespace FreeAX25 {
 			 * Stop the timer
 			 */
 			void stop() {
+				std::unique_lock<std::mutex> shardLock{_lockShard()};
 				std::lock_guard<std::mutex> lock(m_mutex);
 				if (m_running) _stop();
+				_cancel();
+			}
+
+			/**
+			 * Stop the timer and never wait for its callback. Unlike the
+			 * destructor this does not block, so it can be called with
+			 * locks held that the callback takes. Afterwards the timer can
+			 * be destroyed from anywhere, but a callback already running
+			 * might still use the state it captured.
+			 */
+			void detach() {
+				std::unique_lock<std::mutex> shardLock{_lockShard()};
+				std::lock_guard<std::mutex> lock(m_mutex);
+				if (m_running) _stop();
+				_cancel();
+				m_detached = true;
 			}
 
 			/**
@@ -112,6 +151,7 @@ namespace FreeAX25 {
 			 * @param d The duration this timer should run
 			 */
 			void restart(const std::chrono::steady_clock::duration& d) {
+				std::unique_lock<std::mutex> shardLock{_lockShard()};
 				std::lock_guard<std::mutex> lock(m_mutex);
 				if (m_running) _stop();
 				_start(d);
@@ -132,6 +172,47 @@ namespace FreeAX25 {
 				return m_stdDuration;
 			}
 
+			/**
+			 * Allow the timer to expire up to slack later than requested.
+			 * The deadline is rounded up to a granule of no more than
+			 * slack, so timers with a similar slack expire together and
+			 * share one wakeup of the TimerManager. Takes effect on the
+			 * next start.
+			 * @param slack The tolerance, zero for exact timing.
+			 */
+			void setSlack(const std::chrono::steady_clock::duration& slack) {
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_slack = slack;
+			}
+
+			/**
+			 * Get the slack
+			 * @return Slack
+			 */
+			std::chrono::steady_clock::duration getSlack() const {
+				return m_slack;
+			}
+
+			/**
+			 * Move the timer to another TimerManager shard. By default a
+			 * timer uses the shard of the thread that created it. A
+			 * running timer keeps its deadline.
+			 * @param affinity Any number, taken modulo the number of shards.
+			 */
+			void setAffinity(size_t affinity);
+
+			/**
+			 * Run the callback through an executor instead of the
+			 * TimerManager thread or its worker pool. Callbacks that are
+			 * queued but not started yet are dropped on stop() or a
+			 * restart.
+			 * @param executor The executor, nullptr to use the default.
+			 */
+			void setExecutor(TimerExecutor executor) {
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_executor = executor;
+			}
+
 			/**
 			 * Test if the timer is running
 			 * @return If the timer is running
@@ -143,15 +224,44 @@ namespace FreeAX25 {
 		private:
 			const std::string                     m_id;
 			std::chrono::steady_clock::duration   m_stdDuration;
+			std::chrono::steady_clock::duration   m_slack{0};
 			std::function<void()>                 m_function;
+			std::atomic<TimerShard*>              m_shard;
 			std::multimap<std::chrono::steady_clock::time_point, Timer&>::iterator
 												  m_iterator;
 			std::atomic<bool>                     m_running{false};
 			std::mutex                            m_mutex{};
 			std::chrono::steady_clock::time_point m_deadline{};
-			// Unprotected by mutex:
+			bool                                  m_detached{false};
+			// State shared with callbacks dispatched to other threads:
+			struct Dispatch {
+				std::mutex              mutex{};
+				std::condition_variable condition{};
+				uint64_t                generation{0};
+				bool                    running{false};
+				bool                    dispatched{false}; // Not inline
+				std::thread::id         thread{};
+				size_t                  key{0}; // Selects the worker
+				uint64_t current();
+				void cancel();
+				void wait();
+				void run(uint64_t gen, const std::function<void()>& f,
+						bool dispatched);
+			};
+			TimerExecutor                         m_executor{nullptr};
+			std::shared_ptr<Dispatch>             m_dispatch;
+			// Used by TimerWheel, protected by the manager mutex:
+			Timer*                                m_wheelNext{nullptr};
+			Timer*                                m_wheelPrev{nullptr};
+			uint64_t                              m_wheelTick{0};
+			int                                   m_wheelLevel{-1};
+			int                                   m_wheelSlot{0};
+			// Lock the shard the timer is on, always before m_mutex:
+			std::unique_lock<std::mutex> _lockShard();
+			// Called with the shard and m_mutex locked:
 			void _start(const std::chrono::steady_clock::duration& d);
 			void _stop();
+			void _cancel() { m_dispatch->cancel(); }
 		};
 
 	} /* end namespace Runtime */
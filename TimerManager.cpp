@@ -18,11 +18,13 @@
 
 #include "Environment.h"
 #include "TimerManager.h"
+#include "TimerShard.h"
 #include "Timer.h"
 #include "Plugin.h"
 #include "Setting.h"
 
 #include <exception>
+#include <stdexcept>
 #include <string>
 
 namespace FreeAX25 {
@@ -32,10 +34,12 @@ namespace FreeAX25 {
 		using namespace std::chrono;
 
 		TimerManager::TimerManager() {
+			m_shards.emplace_back(new TimerShard(*this, 0));
 		}
 
 		TimerManager::~TimerManager() {
 			terminate();
+			join();
 		}
 
 		void TimerManager::init() {
@@ -43,59 +47,75 @@ namespace FreeAX25 {
 					"tick", 100);
 			m_tick = milliseconds{tick};
 			INF("Set timer tick to " + to_string(tick) + "ms");
+			m_tickless = Setting::asBoolValue(env().configuration.settings,
+					"tickless", false);
+			INF(string("Set timer tickless mode ") + (m_tickless ? "on" : "off"));
+			int workers = Setting::asIntValue(env().configuration.settings,
+					"timerWorkers", 0);
+			if (workers < 0) workers = 0;
+			// Executors from workerExecutor() point to the pool, so it is
+			// never replaced:
+			size_t current = m_workers ? m_workers->size() : 0;
+			if (static_cast<size_t>(workers) != current) {
+				if (m_workers)
+					throw runtime_error(
+							"Can not change the number of timer workers");
+				m_workers.reset(new WorkerPool(workers));
+			}
+			INF("Set timer workers to " + to_string(workers));
+			string backend = Setting::asStringValue(
+					env().configuration.settings, "timerBackend", "multimap");
+			int shards = Setting::asIntValue(env().configuration.settings,
+					"timerShards", 1);
+			if (shards < 1) shards = 1;
+			if (static_cast<size_t>(shards) < m_shards.size())
+				throw runtime_error("Can not reduce the number of timer shards");
+			// Timers keep a pointer to their shard, so shards are never
+			// removed:
+			while (m_shards.size() < static_cast<size_t>(shards))
+				m_shards.emplace_back(new TimerShard(*this, m_shards.size()));
+			for (auto& shard : m_shards) shard->init(backend);
+			INF("Set timer backend to " + backend + " with " +
+					to_string(shards) + " shards");
+		}
+
+		TimerShard& TimerManager::shard(size_t affinity) {
+			return *m_shards[affinity % m_shards.size()];
+		}
+
+		TimerShard& TimerManager::shardForThread() {
+			if (m_shards.size() == 1) return *m_shards[0];
+			// Deal out the shards to threads in order of first use:
+			static atomic<size_t> nextThread{0};
+			thread_local size_t affinity{nextThread++};
+			return shard(affinity);
+		}
+
+		TimerExecutor TimerManager::workerExecutor(size_t key) {
+			if (!m_workers) return nullptr;
+			WorkerPool* workers = m_workers.get();
+			return [workers, key](function<void()> job) {
+				workers->post(key, move(job));
+			};
 		}
 
 		/**
-		 * Run the timer thread
+		 * Run the timer threads
 		 */
 		void TimerManager::start() {
-			std::thread _t{&TimerManager::_run, this};
-			m_thread = std::move(_t);
+			if (m_workers) m_workers->start();
+			for (auto& shard : m_shards) shard->start();
+		}
+
+		void TimerManager::terminate() {
+			for (auto& shard : m_shards) shard->terminate();
 		}
 
-		void TimerManager::_run() {
-			INF("Timer thread running");
-			m_nextPoll = steady_clock::now();
-			while (!m_terminate) {
-				while (!m_terminate) {
-					try {
-						// The function to call:
-						function<void()> callback{nullptr};
-						{ // begin protected block //
-							// Lock the manager:
-							lock_guard<mutex> lock1(m_mutex);
-							auto head = m_activeTimers.begin();
-							// If not more to do, exit inner loop:
-							if ((head == m_activeTimers.end()) ||
-									(head->first > m_nextPoll))
-								break;
-							// Ok, this timer is ripe:
-							Timer& timer = head->second;
-							lock_guard<mutex> lock2(timer.m_mutex);
-							callback = timer.m_function;
-							timer.m_running = false;
-							m_activeTimers.erase(head);
-							timer.m_iterator = m_activeTimers.end();
-						} // end protected block //
-						// Here we are not longer locked
-						callback();
-					}
-					catch (const exception& ex) {
-						env().logError(
-								string("Timer callback with exception: ") +
-								ex.what());
-					}
-					catch (...) {
-						env().logError(
-								string("Timer callback with unknown exception"));
-					}
-				} // end while //
-				// Nothing more left, sleep to next poll:
-				m_nextPoll += m_tick;
-				this_thread::sleep_until(m_nextPoll);
-			} // end while //
-			INF("Timer thread stopping");
+		void TimerManager::join() {
+			for (auto& shard : m_shards) shard->join();
+			if (m_workers) m_workers->stop();
 		}
 
 	} /* end namespace Runtime */
 } /* namespace FreeAX25 */
+
@@ -22,13 +22,13 @@
 #define FREEAX25_RUNTIME_TIMERMANAGER_H_
 
 #include "Timer.h"
+#include "TimerShard.h"
+#include "WorkerPool.h"
 
-#include <map>
 #include <chrono>
-#include <mutex>
+#include <cstddef>
 #include <memory>
-#include <atomic>
-#include <thread>
+#include <vector>
 
 namespace FreeAX25 {
 	namespace Runtime {
@@ -43,6 +43,7 @@ namespace FreeAX25 {
 		 */
 		class TimerManager {
 			friend class Timer;
+			friend class TimerShard;
 
 		public:
 			/**
@@ -82,42 +83,70 @@ namespace FreeAX25 {
 			TimerManager& operator=(TimerManager&& other) = delete;
 
 			/**
-			 * Initialize the TimerManager
+			 * Initialize the TimerManager. The setting "timerBackend"
+			 * selects how active timers are kept: "multimap" (default) or
+			 * "wheel" for the hierarchical TimerWheel. If the setting
+			 * "tickless" is true the timer thread sleeps until the next
+			 * deadline instead of polling every "tick" milliseconds.
+			 * With "timerWorkers" greater than 0 the callbacks run on a
+			 * pool of that many threads, callbacks of one timer always on
+			 * the same thread. "timerShards" splits the timers over that
+			 * many shards, each with its own lock and timer thread.
+			 * Calling init() again applies changed settings and leaves
+			 * the others alone. The backend can only be changed without
+			 * active timers, the number of shards can only grow and the
+			 * number of workers can not be changed once set.
 			 */
 			void init();
 
 			/**
-			 * Run the timer thread
+			 * Run the timer threads
 			 */
 			void start();
 
 			/**
-			 * Terminate the timer thread
+			 * Terminate the timer threads
 			 */
-			void terminate() {
-				m_terminate = true;
-			}
+			void terminate();
 
 			/**
 			 * Wait for timer thread exit.
 			 */
-			void join() {
-				if (m_thread.native_handle() != 0) m_thread.join();
-			}
+			void join();
 
 			/**
-			 * Thread function, invoked by "run()". Do not call it directly!
+			 * Get a shard.
+			 * @param affinity Any number, taken modulo the number of shards.
+			 * @return The shard.
 			 */
-			void _run();
+			TimerShard& shard(size_t affinity);
+
+			/**
+			 * Get the shard for timers created by the calling thread.
+			 * @return The shard.
+			 */
+			TimerShard& shardForThread();
+
+			/**
+			 * Get the number of shards.
+			 * @return Number of shards.
+			 */
+			size_t shards() const { return m_shards.size(); }
+
+			/**
+			 * Get an executor that runs jobs on the timer worker pool.
+			 * Jobs posted with the same key run on the same worker, in
+			 * order.
+			 * @param key Any number, selects the worker.
+			 * @return The executor, nullptr if there are no "timerWorkers".
+			 */
+			TimerExecutor workerExecutor(size_t key);
 
 		private:
-			std::multimap<std::chrono::steady_clock::time_point, Timer&>
-												  m_activeTimers{};
-			std::mutex		                      m_mutex{};
-			std::chrono::steady_clock::time_point m_nextPoll{};
-			std::atomic<bool>                     m_terminate{false};
-			std::thread                           m_thread{};
+			std::vector<std::unique_ptr<TimerShard>> m_shards{};
+			std::unique_ptr<WorkerPool>           m_workers{};
 			std::chrono::steady_clock::duration   m_tick{std::chrono::milliseconds{100}};
+			bool                                  m_tickless{false};
 		};
 
 	} /* end namespace Runtime */
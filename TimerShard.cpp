@@ -0,0 +1,196 @@
+/*
+    Project FreeAX25_Runtime
+    Copyright (C) 2015  tania@df9ry.de
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "TimerShard.h"
+#include "TimerManager.h"
+#include "Environment.h"
+
+#include <cassert>
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace FreeAX25 {
+	namespace Runtime {
+
+		using namespace std;
+		using namespace std::chrono;
+
+		TimerShard::TimerShard(TimerManager& manager, size_t index) :
+			m_manager{manager},
+			m_index{index}
+		{
+		}
+
+		TimerShard::~TimerShard() {
+			terminate();
+			join();
+		}
+
+		void TimerShard::init(const string& backend) {
+			bool wheel;
+			if (backend == "wheel")
+				wheel = true;
+			else if (backend == "multimap")
+				wheel = false;
+			else
+				throw runtime_error("Invalid timerBackend: " + backend);
+			lock_guard<mutex> lock(m_mutex);
+			if (wheel == (m_wheel != nullptr)) return; // Unchanged
+			if (!m_activeTimers.empty() || (m_wheel && m_wheel->size() > 0))
+				throw runtime_error(
+						"Can not change timer backend with active timers");
+			if (wheel)
+				m_wheel.reset(new TimerWheel(steady_clock::now()));
+			else
+				m_wheel.reset();
+		}
+
+		void TimerShard::start() {
+			if (m_thread.joinable()) return;
+			m_terminate = false;
+			std::thread _t{&TimerShard::_run, this};
+			m_thread = std::move(_t);
+		}
+
+		void TimerShard::terminate() {
+			{
+				lock_guard<mutex> lock(m_mutex);
+				m_terminate = true;
+			}
+			m_wakeupCondition.notify_all();
+		}
+
+		void TimerShard::join() {
+			if (m_thread.joinable()) m_thread.join();
+		}
+
+		void TimerShard::_insert(Timer& timer) {
+			if (m_wheel) {
+				m_wheel->insert(timer);
+			}
+			else {
+				assert(timer.m_iterator == m_activeTimers.end());
+				timer.m_iterator = m_activeTimers.insert(
+						pair<steady_clock::time_point, Timer&>(
+								timer.m_deadline, timer));
+			}
+			// Wake up the timer thread if it sleeps too long:
+			if (timer.m_deadline < m_wakeup) m_wakeupCondition.notify_one();
+		}
+
+		void TimerShard::_erase(Timer& timer) {
+			if (m_wheel) {
+				m_wheel->erase(timer);
+				return;
+			}
+			if (timer.m_iterator == m_activeTimers.end()) return;
+			m_activeTimers.erase(timer.m_iterator);
+			timer.m_iterator = m_activeTimers.end();
+		}
+
+		Timer* TimerShard::_ripe(const steady_clock::time_point& now) {
+			if (m_wheel) return m_wheel->ripe(now);
+			auto head = m_activeTimers.begin();
+			if ((head == m_activeTimers.end()) || (head->first > now))
+				return nullptr;
+			return &head->second;
+		}
+
+		steady_clock::time_point TimerShard::_nextDeadline(
+				const steady_clock::time_point& limit)
+		{
+			if (m_wheel) return m_wheel->nextDeadline(limit);
+			auto head = m_activeTimers.begin();
+			if ((head == m_activeTimers.end()) || (head->first > limit))
+				return limit;
+			return head->first;
+		}
+
+		void TimerShard::_run() {
+			INF("Timer thread " + to_string(m_index) + " running");
+			vector<Expired> batch{};
+			m_nextPoll = steady_clock::now();
+			while (!m_terminate) {
+				// Collect all ripe timers in one locked pass:
+				{ // begin protected block //
+					// Lock the shard, then each timer like Timer::stop():
+					lock_guard<mutex> lock1(m_mutex);
+					while (Timer* ripe = _ripe(m_nextPoll)) {
+						Timer& timer = *ripe;
+						lock_guard<mutex> lock2(timer.m_mutex);
+						batch.push_back(Expired{timer.m_dispatch,
+								timer.m_dispatch->current(),
+								timer.m_function, timer.m_executor});
+						timer.m_running = false;
+						_erase(timer);
+					} // end while //
+				} // end protected block //
+				// Here we are not longer locked. A callback that stops
+				// another timer of the batch cancels its callback, too.
+				for (auto& expired : batch) {
+					try {
+						if (!expired.executor && !m_manager.m_workers) {
+							expired.dispatch->run(expired.generation,
+									expired.callback, false);
+							continue;
+						}
+						auto dispatch = expired.dispatch;
+						auto generation = expired.generation;
+						auto callback = move(expired.callback);
+						function<void()> job{[dispatch, generation, callback] {
+							dispatch->run(generation, callback, true);
+						}};
+						if (expired.executor)
+							expired.executor(move(job));
+						else // Same timer, same worker:
+							m_manager.m_workers->post(dispatch->key, move(job));
+					}
+					catch (const exception& ex) {
+						env().logError(
+								string("Timer callback with exception: ") +
+								ex.what());
+					}
+					catch (...) {
+						env().logError(
+								string("Timer callback with unknown exception"));
+					}
+				} // end for //
+				batch.clear();
+				if (m_manager.m_tickless) {
+					// Sleep until the next deadline, Timer::_start() wakes us
+					// up if an earlier one comes in:
+					unique_lock<mutex> lock(m_mutex);
+					if (!m_terminate) {
+						m_wakeup = _nextDeadline(steady_clock::now() + hours{1});
+						m_wakeupCondition.wait_until(lock, m_wakeup);
+						m_wakeup = steady_clock::time_point::min();
+					}
+					m_nextPoll = steady_clock::now();
+					continue;
+				}
+				// Nothing more left, sleep to next poll:
+				m_nextPoll += m_manager.m_tick;
+				this_thread::sleep_until(m_nextPoll);
+			} // end while //
+			INF("Timer thread " + to_string(m_index) + " stopping");
+		}
+
+	} /* end namespace Runtime */
+} /* namespace FreeAX25 */
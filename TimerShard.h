@@ -0,0 +1,141 @@
+/*
+    Project FreeAX25_Runtime
+    Copyright (C) 2015  tania@df9ry.de
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file */
+
+#ifndef FREEAX25_RUNTIME_TIMERSHARD_H_
+#define FREEAX25_RUNTIME_TIMERSHARD_H_
+
+#include "Timer.h"
+#include "TimerWheel.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace FreeAX25 {
+	namespace Runtime {
+
+		class TimerManager;
+
+		/**
+		 * One shard of the TimerManager. Every shard keeps its own active
+		 * timers with its own mutex and runs its own timer thread, so
+		 * timers on different shards never contend.
+		 */
+		class TimerShard {
+			friend class Timer;
+			friend class TimerManager;
+
+		public:
+			/**
+			 * Constructor
+			 * @param manager The TimerManager that owns this shard.
+			 * @param index Index of this shard.
+			 */
+			TimerShard(TimerManager& manager, size_t index);
+
+			/**
+			 * You can not copy a TimerShard.
+			 * @param other Not used.
+			 */
+			TimerShard(const TimerShard& other) = delete;
+
+			/**
+			 * You can not move a TimerShard.
+			 * @param other Not used.
+			 */
+			TimerShard(TimerShard&& other) = delete;
+
+			/**
+			 * Destructor. Terminates the timer thread.
+			 */
+			~TimerShard();
+
+			/**
+			 * You can not assign a TimerShard.
+			 * @param other Not used.
+			 * @return Not used.
+			 */
+			TimerShard& operator=(const TimerShard& other) = delete;
+
+			/**
+			 * You can not assign a TimerShard.
+			 * @param other Not used.
+			 * @return Not used.
+			 */
+			TimerShard& operator=(TimerShard&& other) = delete;
+
+			/**
+			 * Get the index of this shard.
+			 * @return Index.
+			 */
+			size_t index() const { return m_index; }
+
+			/**
+			 * Thread function, invoked by "start()". Do not call it
+			 * directly!
+			 */
+			void _run();
+
+		private:
+			// Timer collected by _run() for its callback:
+			struct Expired {
+				std::shared_ptr<Timer::Dispatch> dispatch;
+				uint64_t                         generation;
+				std::function<void()>            callback;
+				TimerExecutor                    executor;
+			};
+
+			void init(const std::string& backend);
+			void start();
+			void terminate();
+			void join();
+
+			// Backend operations, called with m_mutex locked:
+			void _insert(Timer& timer);
+			void _erase(Timer& timer);
+			Timer* _ripe(const std::chrono::steady_clock::time_point& now);
+			std::chrono::steady_clock::time_point _nextDeadline(
+					const std::chrono::steady_clock::time_point& limit);
+
+			TimerManager&                         m_manager;
+			const size_t                          m_index;
+			std::multimap<std::chrono::steady_clock::time_point, Timer&>
+												  m_activeTimers{};
+			std::unique_ptr<TimerWheel>           m_wheel{};
+			std::mutex		                      m_mutex{};
+			std::chrono::steady_clock::time_point m_nextPoll{};
+			std::atomic<bool>                     m_terminate{false};
+			std::thread                           m_thread{};
+			std::condition_variable               m_wakeupCondition{};
+			std::chrono::steady_clock::time_point m_wakeup{
+					std::chrono::steady_clock::time_point::min()};
+		};
+
+	} /* end namespace Runtime */
+} /* end namespace FreeAX25 */
+
+#endif /* FREEAX25_RUNTIME_TIMERSHARD_H_ */
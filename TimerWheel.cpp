@@ -0,0 +1,219 @@
+/*
+    Project FreeAX25_Runtime
+    Copyright (C) 2015  tania@df9ry.de
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "TimerWheel.h"
+#include "Timer.h"
+
+#include <cassert>
+
+using namespace std;
+using namespace std::chrono;
+
+namespace FreeAX25 {
+	namespace Runtime {
+
+		static const int      BITS = 6; // log2(TimerWheel::SLOTS)
+		static const uint64_t MASK = TimerWheel::SLOTS - 1;
+
+		TimerWheel::TimerWheel(const steady_clock::time_point& start) :
+			m_start{start}
+		{
+		}
+
+		TimerWheel::~TimerWheel() {
+			// Detach all remaining timers, they belong to their owners:
+			for (int level = 0; level < LEVELS; ++level)
+				for (int slot = 0; slot < SLOTS; ++slot)
+					while (m_slots[level][slot].head)
+						unlink(*m_slots[level][slot].head);
+			while (m_overflow.head) unlink(*m_overflow.head);
+			while (m_expired.head) unlink(*m_expired.head);
+		}
+
+		uint64_t TimerWheel::toTick(const steady_clock::time_point& t,
+				bool roundUp) const
+		{
+			if (t <= m_start) return 0;
+			auto ns = duration_cast<nanoseconds>(t - m_start).count();
+			if (roundUp) ns += 999999;
+			return static_cast<uint64_t>(ns / 1000000);
+		}
+
+		TimerWheel::List& TimerWheel::listOf(const Timer& timer) {
+			switch (timer.m_wheelLevel) {
+			case LEVEL_OVERFLOW: return m_overflow;
+			case LEVEL_EXPIRED:  return m_expired;
+			default:       return m_slots[timer.m_wheelLevel][timer.m_wheelSlot];
+			}
+		}
+
+		void TimerWheel::link(Timer& timer, int level, int slot) {
+			timer.m_wheelLevel = level;
+			timer.m_wheelSlot = slot;
+			// Append, so timers with the same deadline keep their order:
+			List& list = listOf(timer);
+			timer.m_wheelNext = nullptr;
+			timer.m_wheelPrev = list.tail;
+			if (list.tail)
+				list.tail->m_wheelNext = &timer;
+			else
+				list.head = &timer;
+			list.tail = &timer;
+			if (level < LEVELS) m_occupied[level] |= uint64_t{1} << slot;
+		}
+
+		void TimerWheel::unlink(Timer& timer) {
+			List& list = listOf(timer);
+			if (timer.m_wheelPrev)
+				timer.m_wheelPrev->m_wheelNext = timer.m_wheelNext;
+			else
+				list.head = timer.m_wheelNext;
+			if (timer.m_wheelNext)
+				timer.m_wheelNext->m_wheelPrev = timer.m_wheelPrev;
+			else
+				list.tail = timer.m_wheelPrev;
+			if ((timer.m_wheelLevel < LEVELS) && !list.head)
+				m_occupied[timer.m_wheelLevel] &=
+						~(uint64_t{1} << timer.m_wheelSlot);
+			timer.m_wheelNext = nullptr;
+			timer.m_wheelPrev = nullptr;
+			timer.m_wheelLevel = -1;
+		}
+
+		void TimerWheel::place(Timer& timer) {
+			uint64_t tick = timer.m_wheelTick;
+			if (tick < m_current) {
+				link(timer, LEVEL_EXPIRED, 0);
+				return;
+			}
+			uint64_t delta = tick - m_current;
+			for (int level = 0; level < LEVELS; ++level) {
+				if (delta < (uint64_t{1} << (BITS * (level + 1)))) {
+					link(timer, level,
+							static_cast<int>((tick >> (BITS * level)) & MASK));
+					return;
+				}
+			} // end for //
+			link(timer, LEVEL_OVERFLOW, 0);
+		}
+
+		void TimerWheel::cascade(int level, int slot) {
+			Timer* timer = m_slots[level][slot].head;
+			m_slots[level][slot] = List{};
+			m_occupied[level] &= ~(uint64_t{1} << slot);
+			while (timer) {
+				Timer* next = timer->m_wheelNext;
+				place(*timer);
+				timer = next;
+			} // end while //
+		}
+
+		void TimerWheel::cascadeOverflow() {
+			Timer* timer = m_overflow.head;
+			m_overflow = List{};
+			while (timer) {
+				Timer* next = timer->m_wheelNext;
+				place(*timer);
+				timer = next;
+			} // end while //
+		}
+
+		void TimerWheel::insert(Timer& timer) {
+			assert(timer.m_wheelLevel == -1);
+			timer.m_wheelTick = toTick(timer.m_deadline, true);
+			place(timer);
+			++m_size;
+		}
+
+		void TimerWheel::erase(Timer& timer) {
+			if (timer.m_wheelLevel == -1) return;
+			unlink(timer);
+			--m_size;
+		}
+
+		steady_clock::time_point TimerWheel::nextDeadline(
+				const steady_clock::time_point& limit) const
+		{
+			if (m_expired.head) return m_start;
+			uint64_t next = UINT64_MAX;
+			for (int level = 0; level < LEVELS; ++level) {
+				if (!m_occupied[level]) continue;
+				// Distance in slots to the next occupied one. The current
+				// slot is only cascaded again if m_current is on its start,
+				// otherwise it belongs to the next revolution:
+				uint64_t base = m_current >> (BITS * level);
+				uint64_t below = (uint64_t{1} << (BITS * level)) - 1;
+				int first = (m_current & below) ? 1 : 0;
+				int shift = static_cast<int>((base + first) & MASK);
+				uint64_t rotated = m_occupied[level];
+				if (shift) rotated = (rotated >> shift) |
+						(rotated << (SLOTS - shift));
+				uint64_t tick = (base + first + __builtin_ctzll(rotated))
+						<< (BITS * level);
+				if (tick < next) next = tick;
+			} // end for //
+			if (m_overflow.head) {
+				uint64_t below = (uint64_t{1} << (BITS * LEVELS)) - 1;
+				uint64_t tick = (m_current + below) & ~below;
+				if (tick < next) next = tick;
+			}
+			if (next == UINT64_MAX) return limit;
+			auto result = m_start + milliseconds{next};
+			return (result < limit) ? result : limit;
+		}
+
+		Timer* TimerWheel::ripe(const steady_clock::time_point& now) {
+			uint64_t limit = toTick(now, false);
+			while (!m_expired.head && (m_current <= limit)) {
+				if (m_size == 0) {
+					// Nothing to do, just catch up:
+					m_current = limit + 1;
+					break;
+				}
+				uint64_t index = m_current & MASK;
+				if (index == 0) {
+					// Lower level wrapped, move timers down:
+					for (int level = 1; level < LEVELS; ++level) {
+						int slot = static_cast<int>(
+								(m_current >> (BITS * level)) & MASK);
+						cascade(level, slot);
+						if (slot != 0) break;
+						if (level == LEVELS - 1) cascadeOverflow();
+					} // end for //
+				}
+				// Skip empty slots up to the next wrap:
+				uint64_t pending = m_occupied[0] >> index;
+				if (pending == 0) {
+					m_current += SLOTS - index;
+					if (m_current > limit + 1) m_current = limit + 1;
+					continue;
+				}
+				m_current += __builtin_ctzll(pending);
+				if (m_current > limit) {
+					m_current = limit + 1;
+					break;
+				}
+				// Everything in this slot is due now:
+				++m_current;
+				cascade(0, static_cast<int>((m_current - 1) & MASK));
+			} // end while //
+			return m_expired.head;
+		}
+
+	} /* end namespace Runtime */
+} /* end namespace FreeAX25 */
@@ -0,0 +1,143 @@
+/*
+    Project FreeAX25_Runtime
+    Copyright (C) 2015  tania@df9ry.de
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file */
+
+#ifndef FREEAX25_RUNTIME_TIMERWHEEL_H_
+#define FREEAX25_RUNTIME_TIMERWHEEL_H_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace FreeAX25 {
+	namespace Runtime {
+
+		class Timer;
+
+		/**
+		 * Hierarchical timing wheel for the TimerManager. Four levels of
+		 * 64 slots with a resolution of 1ms cover about 4.6 hours, later
+		 * timers wait in an overflow list. Timers are linked into the
+		 * slots through fields in Timer, so insert() and erase() are O(1)
+		 * and never allocate. An occupancy bitmap per level lets ripe()
+		 * skip empty slots. Not thread safe, the TimerManager locks.
+		 */
+		class TimerWheel {
+		public:
+			/**
+			 * Number of levels.
+			 */
+			static const int LEVELS = 4;
+
+			/**
+			 * Number of slots per level.
+			 */
+			static const int SLOTS = 64;
+
+			/**
+			 * Constructor.
+			 * @param start Time of tick 0.
+			 */
+			TimerWheel(const std::chrono::steady_clock::time_point& start);
+
+			/**
+			 * You can not copy a TimerWheel.
+			 * @param other Not used.
+			 */
+			TimerWheel(const TimerWheel& other) = delete;
+
+			/**
+			 * You can not assign a TimerWheel.
+			 * @param other Not used.
+			 * @return Not used.
+			 */
+			TimerWheel& operator=(const TimerWheel& other) = delete;
+
+			/**
+			 * Destructor.
+			 */
+			~TimerWheel();
+
+			/**
+			 * Insert a timer at its deadline.
+			 * @param timer The timer, must not be inserted.
+			 */
+			void insert(Timer& timer);
+
+			/**
+			 * Remove a timer. Does nothing if it is not inserted.
+			 * @param timer The timer.
+			 */
+			void erase(Timer& timer);
+
+			/**
+			 * Advance the wheel and get a ripe timer. The timer stays in
+			 * the wheel until it is erased.
+			 * @param now Current time.
+			 * @return A timer whose deadline is not after now, or nullptr.
+			 */
+			Timer* ripe(const std::chrono::steady_clock::time_point& now);
+
+			/**
+			 * Get the time the wheel next needs to be advanced, either
+			 * because a timer gets ripe or because timers have to be moved
+			 * down to a lower level.
+			 * @param limit Result if there is nothing earlier.
+			 * @return Next time, never later than limit.
+			 */
+			std::chrono::steady_clock::time_point nextDeadline(
+					const std::chrono::steady_clock::time_point& limit) const;
+
+			/**
+			 * Get the number of timers in the wheel.
+			 * @return Number of timers.
+			 */
+			size_t size() const { return m_size; }
+
+		private:
+			static const int LEVEL_OVERFLOW = LEVELS;
+			static const int LEVEL_EXPIRED = LEVELS + 1;
+
+			struct List {
+				Timer* head{nullptr};
+				Timer* tail{nullptr};
+			};
+
+			uint64_t toTick(const std::chrono::steady_clock::time_point& t,
+					bool roundUp) const;
+			List& listOf(const Timer& timer);
+			void link(Timer& timer, int level, int slot);
+			void unlink(Timer& timer);
+			void place(Timer& timer);
+			void cascade(int level, int slot);
+			void cascadeOverflow();
+
+			std::chrono::steady_clock::time_point m_start;
+			uint64_t m_current{0}; // Next tick to process
+			List     m_slots[LEVELS][SLOTS];
+			uint64_t m_occupied[LEVELS]{};
+			List     m_overflow{};
+			List     m_expired{};
+			size_t   m_size{0};
+		};
+
+	} /* end namespace Runtime */
+} /* end namespace FreeAX25 */
+
+#endif /* FREEAX25_RUNTIME_TIMERWHEEL_H_ */
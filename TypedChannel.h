@@ -0,0 +1,287 @@
+/*
+    Project FreeAX25_Runtime
+    Copyright (C) 2015  tania@df9ry.de
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file */
+
+#ifndef FREEAX25_RUNTIME_TYPEDCHANNEL_H_
+#define FREEAX25_RUNTIME_TYPEDCHANNEL_H_
+
+#include "Channel.h"
+
+#include <JsonXValue.h>
+
+#include <memory>
+#include <stdexcept>
+
+namespace FreeAX25 {
+	namespace Runtime {
+
+		/**
+		 * Default handler methods for a TypedChannel. Derive your handler
+		 * from this class and hide the methods you support with methods of
+		 * the same signature. No virtual calls are involved.
+		 */
+		class ChannelHandler {
+		public:
+			/**
+			 * Handle a connect request.
+			 * @param backlink ChannelProxy for backlink.
+			 * @param parameter Parameter for connect.
+			 * @return ChannelProxy where subsequent requests can be sent to.
+			 */
+			ChannelProxy onConnect(ChannelProxy backlink,
+					std::unique_ptr<JsonX::Object>&& parameter) {
+				throw std::runtime_error("Connect not supported");
+			}
+
+			/**
+			 * Handle an open request.
+			 * @param parameter Parameter for open.
+			 */
+			void onOpen(std::unique_ptr<JsonX::Object>&& parameter) {
+				throw std::runtime_error("Open not supported");
+			}
+
+			/**
+			 * Handle a close request.
+			 * @param parameter Parameter for close.
+			 */
+			void onClose(std::unique_ptr<JsonX::Object>&& parameter) {
+				throw std::runtime_error("Close not supported");
+			}
+
+			/**
+			 * Handle a message.
+			 * @param message The message.
+			 * @param priority Message priority.
+			 */
+			void onReceive(std::unique_ptr<JsonX::Object>&& message,
+					MessagePriority priority) {
+				throw std::runtime_error("Receive not supported");
+			}
+
+			/**
+			 * Handle a binary frame.
+			 * @param frame The frame.
+			 * @param priority Message priority.
+			 */
+			void onReceiveFrame(const Frame& frame, MessagePriority priority) {
+				throw std::runtime_error("Receive frame not supported");
+			}
+
+			/**
+			 * Handle a control request.
+			 * @param request The request.
+			 * @return Response.
+			 */
+			std::unique_ptr<JsonX::Object> onCtrl(
+					std::unique_ptr<JsonX::Object>&& request) {
+				throw std::runtime_error("Control not supported");
+			}
+		};
+
+		template <typename Handler>
+		class TypedChannelProxy;
+
+		/**
+		 * A Channel whose handler type is fixed at compile time. Requests
+		 * that come through a ChannelProxy are dispatched through one
+		 * static table per Handler type, with the handler methods inlined
+		 * into the table entries, instead of going through the
+		 * std::function members of Channel. A sender that knows the
+		 * Handler type can use a TypedChannelProxy, which calls the handler
+		 * directly. A TypedChannel is used like any other Channel by its
+		 * peers. It is not smaller than a Channel, the std::function
+		 * members stay in every Channel as the dynamic fallback.
+		 */
+		template <typename Handler>
+		class TypedChannel : public Channel {
+			friend class TypedChannelProxy<Handler>;
+
+		public:
+			/**
+			 * Constructor.
+			 * @param session Session this channel is attached to.
+			 * @param handler Handler for incoming requests. Has to live as
+			 *                long as this channel.
+			 */
+			TypedChannel(std::shared_ptr<SessionBase> session, Handler& handler):
+				Channel(session), m_handler(handler)
+			{
+				bind(&s_dispatch);
+			}
+
+			/**
+			 * Get the handler.
+			 * @return The handler.
+			 */
+			Handler& handler() { return m_handler; }
+
+			/**
+			 * Get a proxy to this channel that knows the handler type.
+			 * @return TypedChannelProxy.
+			 */
+			TypedChannelProxy<Handler> getTypedProxy() {
+				return TypedChannelProxy<Handler>(this);
+			}
+
+		private:
+			bool isBound() const { return Channel::isBound(&s_dispatch); }
+
+			static Handler& handlerOf(Channel& channel) {
+				return static_cast<TypedChannel<Handler>&>(channel).m_handler;
+			}
+
+			static ChannelProxy doConnect(Channel& channel, ChannelProxy backlink,
+					std::unique_ptr<JsonX::Object>&& parameter) {
+				return handlerOf(channel).onConnect(backlink, std::move(parameter));
+			}
+
+			static void doOpen(Channel& channel,
+					std::unique_ptr<JsonX::Object>&& parameter) {
+				handlerOf(channel).onOpen(std::move(parameter));
+			}
+
+			static void doClose(Channel& channel,
+					std::unique_ptr<JsonX::Object>&& parameter) {
+				handlerOf(channel).onClose(std::move(parameter));
+			}
+
+			static void doReceive(Channel& channel,
+					std::unique_ptr<JsonX::Object>&& message,
+					MessagePriority priority) {
+				handlerOf(channel).onReceive(std::move(message), priority);
+			}
+
+			static void doReceiveFrame(Channel& channel, const Frame& frame,
+					MessagePriority priority) {
+				handlerOf(channel).onReceiveFrame(frame, priority);
+			}
+
+			static std::unique_ptr<JsonX::Object> doCtrl(Channel& channel,
+					std::unique_ptr<JsonX::Object>&& request) {
+				return handlerOf(channel).onCtrl(std::move(request));
+			}
+
+			void receiveDirect(std::unique_ptr<JsonX::Object>&& message,
+					MessagePriority priority) {
+				deliverTo([this](std::unique_ptr<JsonX::Object>&& message,
+						MessagePriority priority) {
+					m_handler.onReceive(std::move(message), priority);
+				}, std::move(message), priority);
+			}
+
+			void receiveFrameDirect(const Frame& frame, MessagePriority priority) {
+				deliverFrameTo([this](const Frame& frame, MessagePriority priority) {
+					m_handler.onReceiveFrame(frame, priority);
+				}, frame, priority);
+			}
+
+			static const ChannelDispatch s_dispatch;
+
+			Handler& m_handler;
+		};
+
+		template <typename Handler>
+		const ChannelDispatch TypedChannel<Handler>::s_dispatch = {
+			&TypedChannel<Handler>::doConnect,
+			&TypedChannel<Handler>::doOpen,
+			&TypedChannel<Handler>::doClose,
+			&TypedChannel<Handler>::doReceive,
+			&TypedChannel<Handler>::doReceiveFrame,
+			&TypedChannel<Handler>::doCtrl
+		};
+
+		/**
+		 * Proxy to a TypedChannel for senders that know its Handler type.
+		 * If the channel delivers immediately, send() and sendFrame() call
+		 * the handler methods directly, so the compiler can inline them.
+		 * In queued or trampolined delivery mode they go through the
+		 * ChannelProxy like any other message. After the channel was reset
+		 * they throw "Connection closed".
+		 */
+		template <typename Handler>
+		class TypedChannelProxy {
+			friend class TypedChannel<Handler>;
+
+		public:
+			/**
+			 * Default constructor, the proxy is not set.
+			 */
+			TypedChannelProxy() {}
+
+			/**
+			 * Test if the proxy is set.
+			 * @return If the proxy is set.
+			 */
+			explicit operator bool() const noexcept { return m_channel; }
+
+			/**
+			 * Send a message.
+			 * @param message Message to send.
+			 * @param priority Message priority.
+			 */
+			void send(std::unique_ptr<JsonX::Object>&& message,
+					MessagePriority priority = MessagePriority::ROUTINE)
+			{
+				// After Channel::reset() the handler may be gone:
+				if (!m_channel || !m_channel->isBound())
+					throw std::runtime_error("Connection closed");
+				if (m_channel->isImmediate())
+					m_channel->receiveDirect(std::move(message), priority);
+				else
+					m_proxy.send(std::move(message), priority);
+			}
+
+			/**
+			 * Send a binary frame. The payload is shared, not copied.
+			 * @param frame Frame to send.
+			 * @param priority Message priority.
+			 */
+			void sendFrame(const Frame& frame,
+					MessagePriority priority = MessagePriority::ROUTINE)
+			{
+				// After Channel::reset() the handler may be gone:
+				if (!m_channel || !m_channel->isBound())
+					throw std::runtime_error("Connection closed");
+				if (m_channel->isImmediate())
+					m_channel->receiveFrameDirect(frame, priority);
+				else
+					m_proxy.sendFrame(frame, priority);
+			}
+
+			/**
+			 * Get the untyped proxy, for everything else.
+			 * @return ChannelProxy.
+			 */
+			ChannelProxy proxy() const { return m_proxy; }
+
+		private:
+			TypedChannelProxy(TypedChannel<Handler>* channel):
+				m_proxy{channel->getLocalProxy()}, m_channel{channel}
+			{
+			}
+
+			ChannelProxy            m_proxy{};
+			TypedChannel<Handler>*  m_channel{nullptr};
+		};
+
+	} /* end namespace Runtime */
+} /* end namespace FreeAX25 */
+
+#endif /* FREEAX25_RUNTIME_TYPEDCHANNEL_H_ */
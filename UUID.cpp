@@ -18,17 +18,165 @@
 
 #include "UUID.h"
 
-#include <uuid/uuid.h>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <pthread.h>
+#include <sys/random.h>
+
+using namespace std;
 
 namespace FreeAX25 {
 	namespace Runtime {
 
+		// ChaCha20 blocks per batch. The first 32 bytes of every batch
+		// become the next key, so earlier output can not be recovered:
+		static const size_t BATCH_BLOCKS = 8;
+		static const size_t BLOCK_SIZE = 64;
+		static const size_t KEY_SIZE = 32;
+		// Fresh kernel randomness after this many batches:
+		static const uint64_t RESEED_BATCHES = 4096;
+
+		// Bumped in the child after fork(), so it does not repeat the
+		// parent's sequence:
+		static atomic<uint64_t> forkGeneration{0};
+
+		static void onFork()
+		{
+			forkGeneration.fetch_add(1);
+		}
+
+		static inline uint32_t rotl(uint32_t v, int n)
+		{
+			return (v << n) | (v >> (32 - n));
+		}
+
+		static inline void quarterRound(uint32_t* x, int a, int b, int c, int d)
+		{
+			x[a] += x[b]; x[d] = rotl(x[d] ^ x[a], 16);
+			x[c] += x[d]; x[b] = rotl(x[b] ^ x[c], 12);
+			x[a] += x[b]; x[d] = rotl(x[d] ^ x[a], 8);
+			x[c] += x[d]; x[b] = rotl(x[b] ^ x[c], 7);
+		}
+
+		static void chachaBlock(const uint32_t* key, uint64_t counter, uint8_t* out)
+		{
+			uint32_t input[16] = {
+				0x61707865, 0x3320646e, 0x79622d32, 0x6b206574,
+				key[0], key[1], key[2], key[3],
+				key[4], key[5], key[6], key[7],
+				(uint32_t)counter, (uint32_t)(counter >> 32), 0, 0
+			};
+			uint32_t x[16];
+			memcpy(x, input, sizeof(x));
+			for (int i = 0; i < 10; ++i) {
+				quarterRound(x, 0, 4,  8, 12);
+				quarterRound(x, 1, 5,  9, 13);
+				quarterRound(x, 2, 6, 10, 14);
+				quarterRound(x, 3, 7, 11, 15);
+				quarterRound(x, 0, 5, 10, 15);
+				quarterRound(x, 1, 6, 11, 12);
+				quarterRound(x, 2, 7,  8, 13);
+				quarterRound(x, 3, 4,  9, 14);
+			} // end for //
+			for (int i = 0; i < 16; ++i) {
+				uint32_t v = x[i] + input[i];
+				out[4 * i]     = (uint8_t)v;
+				out[4 * i + 1] = (uint8_t)(v >> 8);
+				out[4 * i + 2] = (uint8_t)(v >> 16);
+				out[4 * i + 3] = (uint8_t)(v >> 24);
+			} // end for //
+		}
+
+		/**
+		 * Random generator of one thread.
+		 */
+		class UUIDGenerator {
+		public:
+			void next(uint8_t* uuid) {
+				if ((m_position + UUID_SIZE > sizeof(m_batch)) ||
+						(m_forkGeneration != forkGeneration.load(memory_order_relaxed)))
+					refill();
+				memcpy(uuid, m_batch + m_position, UUID_SIZE);
+				// Do not keep handed out bits around:
+				memset(m_batch + m_position, 0, UUID_SIZE);
+				m_position += UUID_SIZE;
+			}
+
+			~UUIDGenerator() {
+				memset(m_key, 0, sizeof(m_key));
+				memset(m_batch, 0, sizeof(m_batch));
+			}
+
+		private:
+			void seed() {
+				static pthread_once_t once = PTHREAD_ONCE_INIT;
+				pthread_once(&once, []() { pthread_atfork(nullptr, nullptr, onFork); });
+				m_forkGeneration = forkGeneration.load();
+				uint8_t* p = reinterpret_cast<uint8_t*>(m_key);
+				size_t n = 0;
+				while (n < sizeof(m_key)) {
+					ssize_t r = getrandom(p + n, sizeof(m_key) - n, 0);
+					if (r < 0) {
+						if (errno == EINTR) continue;
+						throw runtime_error(
+								string("Unable to get random bytes! Cause: ") + strerror(errno));
+					}
+					n += r;
+				} // end while //
+				m_counter = 0;
+				m_batches = 0;
+			}
+
+			void refill() {
+				if ((m_batches == 0) || (m_batches >= RESEED_BATCHES) ||
+						(m_forkGeneration != forkGeneration.load(memory_order_relaxed)))
+					seed();
+				uint8_t blocks[BATCH_BLOCKS * BLOCK_SIZE];
+				for (size_t i = 0; i < BATCH_BLOCKS; ++i)
+					chachaBlock(m_key, m_counter++, blocks + i * BLOCK_SIZE);
+				memcpy(m_key, blocks, KEY_SIZE);
+				memcpy(m_batch, blocks + KEY_SIZE, sizeof(m_batch));
+				memset(blocks, 0, sizeof(blocks));
+				m_position = 0;
+				++m_batches;
+			}
+
+			uint32_t m_key[KEY_SIZE / 4];
+			uint8_t  m_batch[BATCH_BLOCKS * BLOCK_SIZE - KEY_SIZE];
+			size_t   m_position{sizeof(m_batch)};
+			uint64_t m_counter{0};
+			uint64_t m_batches{0};
+			uint64_t m_forkGeneration{0};
+		};
+
+		static thread_local UUIDGenerator generator{};
+
+		void newUUID(uint8_t* uuid) {
+			generator.next(uuid);
+			uuid[6] = (uuid[6] & 0x0f) | 0x40; // Version 4
+			uuid[8] = (uuid[8] & 0x3f) | 0x80; // Variant RFC 4122
+		}
+
+		void formatUUID(const uint8_t* uuid, char* buffer) {
+			static const char hex[] = "0123456789abcdef";
+			char* p = buffer;
+			for (size_t i = 0; i < UUID_SIZE; ++i) {
+				if ((i == 4) || (i == 6) || (i == 8) || (i == 10)) *p++ = '-';
+				*p++ = hex[uuid[i] >> 4];
+				*p++ = hex[uuid[i] & 0x0f];
+			} // end for //
+			*p = '\0';
+		}
+
 		std::string newUUID() {
-			uuid_t uuid;
-			uuid_generate_random(uuid);
-			char s[37];
-			uuid_unparse(uuid, s);
-			return s;
+			uint8_t uuid[UUID_SIZE];
+			newUUID(uuid);
+			char s[UUID_TEXT_LENGTH + 1];
+			formatUUID(uuid, s);
+			return std::string(s, UUID_TEXT_LENGTH);
 		}
 
 	} /* end namespace Runtime */
@@ -21,11 +21,40 @@
 #ifndef FREEAX25_RUNTIME_UUID_H_
 #define FREEAX25_RUNTIME_UUID_H_
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
 
 namespace FreeAX25 {
 	namespace Runtime {
 
+		/**
+		 * Size of a UUID in bytes.
+		 */
+		const size_t UUID_SIZE = 16;
+
+		/**
+		 * Length of the text form of a UUID, without the terminating zero.
+		 */
+		const size_t UUID_TEXT_LENGTH = 36;
+
+		/**
+		 * Generate a new random UUID (RFC 4122 version 4). The random bits
+		 * come from a ChaCha20 generator per thread. It is seeded from the
+		 * kernel, reseeded periodically and after fork(), and fills a
+		 * batch of ids at once, so there is no system call per id.
+		 * @param uuid Receives the UUID.
+		 */
+		extern void newUUID(uint8_t* uuid);
+
+		/**
+		 * Write the text form of a UUID. Nothing is allocated.
+		 * @param uuid The UUID.
+		 * @param buffer Buffer for UUID_TEXT_LENGTH characters plus a
+		 *               terminating zero.
+		 */
+		extern void formatUUID(const uint8_t* uuid, char* buffer);
+
 		/**
 		 * Generate a new random UUID.
 		 * @return New UUID as a string.
@@ -0,0 +1,77 @@
+/*
+    Project FreeAX25_Runtime
+    Copyright (C) 2015  tania@df9ry.de
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Wakeup.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace FreeAX25 {
+	namespace Runtime {
+
+		Wakeup::Wakeup():
+			m_fd{eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)}
+		{
+			if (m_fd < 0) throw runtime_error(
+				string("Unable to create eventfd! Cause: ") + strerror(errno));
+		}
+
+		Wakeup::~Wakeup()
+		{
+			close(m_fd);
+		}
+
+		void Wakeup::signal()
+		{
+			// Pairs with the check for data after arm() on the consumer side:
+			atomic_thread_fence(memory_order_seq_cst);
+			if (!m_armed.load()) return;
+			uint64_t one = 1;
+			ssize_t rc = write(m_fd, &one, sizeof(one));
+			(void)rc; // Counter overflow is harmless, it is signaled anyway
+		}
+
+		bool Wakeup::wait(int timeout)
+		{
+			struct pollfd pfd;
+			pfd.fd = m_fd;
+			pfd.events = POLLIN;
+			pfd.revents = 0;
+			int rc;
+			do {
+				rc = poll(&pfd, 1, timeout);
+			} while ((rc < 0) && (errno == EINTR));
+			m_armed.store(false);
+			if (rc <= 0) return false;
+			uint64_t count;
+			ssize_t n = read(m_fd, &count, sizeof(count));
+			(void)n; // Only clears the counter
+			return true;
+		}
+
+	} /* end namespace Runtime */
+} /* end namespace FreeAX25 */
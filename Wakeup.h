@@ -0,0 +1,109 @@
+/*
+    Project FreeAX25_Runtime
+    Copyright (C) 2015  tania@df9ry.de
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file */
+
+#ifndef FREEAX25_RUNTIME_WAKEUP_H_
+#define FREEAX25_RUNTIME_WAKEUP_H_
+
+#include <atomic>
+
+namespace FreeAX25 {
+	namespace Runtime {
+
+		/**
+		 * Cheap wakeup of a single waiting thread, based on an eventfd.
+		 * signal() only makes a system call while the consumer is actually
+		 * waiting.
+		 */
+		class Wakeup {
+		public:
+			/**
+			 * Constructor.
+			 */
+			Wakeup();
+
+			/**
+			 * You can not copy a Wakeup.
+			 * @param other Not used.
+			 */
+			Wakeup(const Wakeup& other) = delete;
+
+			/**
+			 * You can not move a Wakeup.
+			 * @param other Not used.
+			 */
+			Wakeup(Wakeup&& other) = delete;
+
+			/**
+			 * You can not assign a Wakeup.
+			 * @param other Not used.
+			 * @return Not used.
+			 */
+			Wakeup& operator=(const Wakeup& other) = delete;
+
+			/**
+			 * You can not assign a Wakeup.
+			 * @param other Not used.
+			 * @return Not used.
+			 */
+			Wakeup& operator=(Wakeup&& other) = delete;
+
+			/**
+			 * Destructor.
+			 */
+			~Wakeup();
+
+			/**
+			 * Wake up the waiting thread, if there is one. Call this after
+			 * the data was published.
+			 */
+			void signal();
+
+			/**
+			 * Announce that the consumer is going to wait. The consumer has
+			 * to check for data after this call and before wait().
+			 */
+			void arm() {
+				m_armed.store(true);
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+			}
+
+			/**
+			 * Wait for a signal. Has to be preceded by arm().
+			 * @param timeout Timeout in milliseconds, -1 for infinite.
+			 * @return false on timeout.
+			 */
+			bool wait(int timeout);
+
+			/**
+			 * Cancel a wait that was announced with arm().
+			 */
+			void disarm() {
+				m_armed.store(false);
+			}
+
+		private:
+			int               m_fd;
+			std::atomic<bool> m_armed{false};
+		};
+
+	} /* end namespace Runtime */
+} /* end namespace FreeAX25 */
+
+#endif /* FREEAX25_RUNTIME_WAKEUP_H_ */
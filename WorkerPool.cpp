@@ -0,0 +1,96 @@
+/*
+    Project FreeAX25_Runtime
+    Copyright (C) 2015  tania@df9ry.de
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "WorkerPool.h"
+#include "Environment.h"
+
+#include <exception>
+#include <string>
+
+using namespace std;
+
+namespace FreeAX25 {
+	namespace Runtime {
+
+		WorkerPool::WorkerPool(size_t size) {
+			if (size == 0) size = 1;
+			for (size_t i = 0; i < size; ++i)
+				m_workers.emplace_back(new Worker());
+		}
+
+		WorkerPool::~WorkerPool() {
+			stop();
+		}
+
+		void WorkerPool::start() {
+			for (auto& worker : m_workers) {
+				if (worker->thread.joinable()) continue;
+				worker->terminate = false;
+				worker->thread = thread{&WorkerPool::_run, this, ref(*worker)};
+			} // end for //
+		}
+
+		void WorkerPool::stop() {
+			for (auto& worker : m_workers) {
+				{
+					lock_guard<mutex> lock(worker->mutex);
+					worker->terminate = true;
+				}
+				worker->condition.notify_one();
+			} // end for //
+			for (auto& worker : m_workers)
+				if (worker->thread.joinable()) worker->thread.join();
+		}
+
+		void WorkerPool::post(size_t key, function<void()> job) {
+			Worker& worker = *m_workers[key % m_workers.size()];
+			{
+				lock_guard<mutex> lock(worker.mutex);
+				worker.jobs.push_back(move(job));
+			}
+			worker.condition.notify_one();
+		}
+
+		void WorkerPool::_run(Worker& worker) {
+			while (true) {
+				function<void()> job{nullptr};
+				{ // begin protected block //
+					unique_lock<mutex> lock(worker.mutex);
+					worker.condition.wait(lock, [&worker] {
+						return worker.terminate || !worker.jobs.empty();
+					});
+					if (worker.jobs.empty()) break; // Terminated and drained
+					job = move(worker.jobs.front());
+					worker.jobs.pop_front();
+				} // end protected block //
+				try {
+					job();
+				}
+				catch (const exception& ex) {
+					env().logError(
+							string("Worker job with exception: ") + ex.what());
+				}
+				catch (...) {
+					env().logError(
+							string("Worker job with unknown exception"));
+				}
+			} // end while //
+		}
+
+	} /* end namespace Runtime */
+} /* end namespace FreeAX25 */
@@ -0,0 +1,121 @@
+/*
+    Project FreeAX25_Runtime
+    Copyright (C) 2015  tania@df9ry.de
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file */
+
+#ifndef FREEAX25_RUNTIME_WORKERPOOL_H_
+#define FREEAX25_RUNTIME_WORKERPOOL_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace FreeAX25 {
+	namespace Runtime {
+
+		/**
+		 * Fixed set of worker threads, each with its own queue. Jobs
+		 * posted with the same key always run on the same worker, one
+		 * after the other and in the order they were posted.
+		 */
+		class WorkerPool {
+		public:
+			/**
+			 * Constructor. The workers are not started.
+			 * @param size Number of workers, at least 1.
+			 */
+			WorkerPool(size_t size);
+
+			/**
+			 * You can not copy a WorkerPool.
+			 * @param other Not used.
+			 */
+			WorkerPool(const WorkerPool& other) = delete;
+
+			/**
+			 * You can not move a WorkerPool.
+			 * @param other Not used.
+			 */
+			WorkerPool(WorkerPool&& other) = delete;
+
+			/**
+			 * You can not assign a WorkerPool.
+			 * @param other Not used.
+			 * @return Not used.
+			 */
+			WorkerPool& operator=(const WorkerPool& other) = delete;
+
+			/**
+			 * You can not assign a WorkerPool.
+			 * @param other Not used.
+			 * @return Not used.
+			 */
+			WorkerPool& operator=(WorkerPool&& other) = delete;
+
+			/**
+			 * Destructor. Stops the workers.
+			 */
+			~WorkerPool();
+
+			/**
+			 * Start the worker threads.
+			 */
+			void start();
+
+			/**
+			 * Run the jobs that are still queued, then stop and join the
+			 * worker threads.
+			 */
+			void stop();
+
+			/**
+			 * Queue a job.
+			 * @param key Selects the worker.
+			 * @param job The job to run.
+			 */
+			void post(size_t key, std::function<void()> job);
+
+			/**
+			 * Get the number of workers.
+			 * @return Number of workers.
+			 */
+			size_t size() const { return m_workers.size(); }
+
+		private:
+			struct Worker {
+				std::mutex                        mutex{};
+				std::condition_variable           condition{};
+				std::deque<std::function<void()>> jobs{};
+				bool                              terminate{false};
+				std::thread                       thread{};
+			};
+
+			void _run(Worker& worker);
+
+			std::vector<std::unique_ptr<Worker>> m_workers{};
+		};
+
+	} /* end namespace Runtime */
+} /* end namespace FreeAX25 */
+
+#endif /* FREEAX25_RUNTIME_WORKERPOOL_H_ */
@@ -0,0 +1,128 @@
+/*
+    Project FreeAX25_Runtime
+    Copyright (C) 2015  tania@df9ry.de
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file */
+
+/*
+ * Benchmark of the binary MessageCodec against JsonX text serialization,
+ * the path ShmTransport used before. For a few typical messages it
+ * prints the encoded size and the time to encode and to decode.
+ *
+ * Usage: CodecBench [count]
+ */
+
+#include "MessageCodec.h"
+
+#include <JsonXValue.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+using namespace FreeAX25::Runtime;
+
+// Keeps the compiler from dropping the loops:
+static volatile size_t sink;
+
+template <typename F>
+static double nsPerCall(size_t count, F f) {
+	auto start = steady_clock::now();
+	for (size_t i = 0; i < count; ++i) f();
+	return duration<double, nano>(steady_clock::now() - start).count() / count;
+}
+
+// A control request:
+static unique_ptr<JsonX::Object> ctrlMessage() {
+	unique_ptr<JsonX::Object> m{JsonX::Object::make()};
+	m->set("op", JsonX::String::make("stats"));
+	return m;
+}
+
+// An I frame on its way through the stack:
+static unique_ptr<JsonX::Object> frameMessage() {
+	unique_ptr<JsonX::Object> m{JsonX::Object::make()};
+	m->set("op", JsonX::String::make("data"));
+	m->set("src", JsonX::String::make("DF9RY-1"));
+	m->set("dst", JsonX::String::make("DB0ABC-10"));
+	unique_ptr<JsonX::Array> via{JsonX::Array::make()};
+	via->append(JsonX::String::make("WIDE1-1"));
+	via->append(JsonX::String::make("WIDE2-2"));
+	m->set("via", move(via));
+	m->set("pid", JsonX::Number::make(240));
+	m->set("nr", JsonX::Number::make(3));
+	m->set("ns", JsonX::Number::make(5));
+	m->set("poll", JsonX::Bool::make(false));
+	m->set("info", JsonX::String::make(
+			"The quick brown fox jumps over the lazy dog 0123456789"));
+	return m;
+}
+
+// A statistics response with nested maps and fractions:
+static unique_ptr<JsonX::Object> statsMessage() {
+	unique_ptr<JsonX::Object> m{JsonX::Object::make()};
+	const char* lanes[] = { "priority", "routine" };
+	for (const char* lane : lanes) {
+		unique_ptr<JsonX::Object> l{JsonX::Object::make()};
+		l->set("messages", JsonX::Number::make(1234567));
+		l->set("bytes", JsonX::Number::make(98765432));
+		l->set("latencyMean", JsonX::Number::make(1523.25));
+		l->set("latencyMax", JsonX::Number::make(81234.5));
+		l->set("errors", JsonX::Number::make(0));
+		m->set(lane, move(l));
+	} // end for //
+	m->set("enabled", JsonX::Bool::make(true));
+	m->set("session", JsonX::Null::make());
+	return m;
+}
+
+static void run(const char* name, const JsonX::Object& message, size_t count) {
+	vector<uint8_t> buffer(MessageCodec::encodedSize(message));
+	size_t size = MessageCodec::encode(message, buffer.data(), buffer.size());
+	string text{message.toString()};
+	double binaryEncode = nsPerCall(count, [&]() {
+		sink = MessageCodec::encode(message, buffer.data(), buffer.size());
+	});
+	double binaryDecode = nsPerCall(count, [&]() {
+		sink = MessageCodec::decode(buffer.data(), size) ? 1 : 0;
+	});
+	double textEncode = nsPerCall(count, [&]() {
+		sink = message.toString().size();
+	});
+	double textDecode = nsPerCall(count, [&]() {
+		sink = JsonX::parse(text) ? 1 : 0;
+	});
+	printf("%-6s %8zu %10.1f %10.1f %8zu %10.1f %10.1f\n", name,
+			size, binaryEncode, binaryDecode,
+			text.size(), textEncode, textDecode);
+}
+
+int main(int argc, char** argv) {
+	size_t count = (argc > 1) ? strtoul(argv[1], nullptr, 10) : 200000;
+	printf("%-6s %8s %10s %10s %8s %10s %10s\n", "",
+			"bytes", "encode ns", "decode ns",
+			"text", "encode ns", "decode ns");
+	run("ctrl", *ctrlMessage(), count);
+	run("frame", *frameMessage(), count);
+	run("stats", *statsMessage(), count);
+	return 0;
+}
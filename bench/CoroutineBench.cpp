@@ -0,0 +1,126 @@
+/*
+    Project FreeAX25_Runtime
+    Copyright (C) 2015  tania@df9ry.de
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file */
+
+/*
+ * Benchmark of the C++20 coroutine layer against the plain callbacks of
+ * Channel: receiving messages and sending control requests that are
+ * answered right away. Without "timerWorkers" a CoChannel resumes its
+ * coroutine inline, so this measures the overhead of the awaitables. It
+ * is built with -std=c++20 and also makes sure ChannelCoroutine.h
+ * compiles.
+ *
+ * Usage: CoroutineBench [count]
+ */
+
+#include "Channel.h"
+#include "ChannelCoroutine.h"
+#include "Environment.h"
+#include "SessionBase.h"
+
+#include <JsonXValue.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+
+#if !defined(__cpp_impl_coroutine)
+#error "CoroutineBench needs a compiler with C++20 coroutines"
+#endif
+
+using namespace std;
+using namespace std::chrono;
+using namespace FreeAX25::Runtime;
+
+class Peer: public SessionBase {
+public:
+	Channel channel{m_pointer};
+	void link(ChannelProxy proxy) { setRemote(channel, proxy); }
+};
+
+template <typename F>
+static double nsPerCall(size_t count, F f) {
+	auto start = steady_clock::now();
+	for (size_t i = 0; i < count; ++i) f();
+	return duration<double, nano>(steady_clock::now() - start).count() / count;
+}
+
+static CoTask receiver(CoChannel& channel, size_t count, size_t& received) {
+	for (size_t i = 0; i < count; ++i) {
+		CoMessage m = co_await channel.receive();
+		if (m.message) ++received;
+	} // end for //
+}
+
+static CoTask requester(CoChannel& channel, size_t count, size_t& answered) {
+	for (size_t i = 0; i < count; ++i) {
+		unique_ptr<JsonX::Object> response =
+				co_await channel.ctrl(JsonX::Object::make());
+		if (response) ++answered;
+	} // end for //
+}
+
+int main(int argc, char** argv) {
+	size_t count = (argc > 1) ? strtoul(argv[1], nullptr, 10) : 1000000;
+	static Environment e{};
+	env(&e);
+	Peer* a = new Peer();
+	Peer* b = new Peer();
+	a->link(b->channel.getLocalProxy());
+	b->link(a->channel.getLocalProxy());
+	b->channel.ctrlFunction = [](unique_ptr<JsonX::Object>&&) {
+		return JsonX::Object::make();
+	};
+
+	size_t received = 0;
+	a->channel.receiveFunction = [&received](
+			unique_ptr<JsonX::Object>&& message, MessagePriority) {
+		if (message) ++received;
+	};
+	double plainReceive = nsPerCall(count, [b]() {
+		b->channel.send(JsonX::Object::make());
+	});
+	size_t answered = 0;
+	double plainCtrl = nsPerCall(count, [a, &answered]() {
+		if (a->channel.ctrl(JsonX::Object::make())) ++answered;
+	});
+
+	double coReceive, coCtrl;
+	{
+		CoChannel channel{a->channel};
+		receiver(channel, count, received);
+		coReceive = nsPerCall(count, [b]() {
+			b->channel.send(JsonX::Object::make());
+		});
+		auto start = steady_clock::now();
+		requester(channel, count, answered);
+		coCtrl = duration<double, nano>(steady_clock::now() - start).count() / count;
+	}
+	if ((received != 2 * count) || (answered != 2 * count)) {
+		fprintf(stderr, "Lost messages: %zu received, %zu answered\n",
+				received, answered);
+		return 1;
+	}
+
+	printf("%-10s %12s %12s\n", "", "callback ns", "coroutine ns");
+	printf("%-10s %12.1f %12.1f\n", "receive", plainReceive, coReceive);
+	printf("%-10s %12.1f %12.1f\n", "ctrl", plainCtrl, coCtrl);
+	return 0;
+}
@@ -0,0 +1,102 @@
+/*
+    Project FreeAX25_Runtime
+    Copyright (C) 2015  tania@df9ry.de
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/** @file */
+
+/*
+ * Benchmark of the timer shards. For 1 to 32 shards and 1 to 32 threads
+ * every thread restarts timers of its own as fast as it can. Timers
+ * created by a thread go to the shard of that thread, so the threads only
+ * contend when they share a shard. Prints the throughput of all threads
+ * in million restarts per second.
+ *
+ * Usage: ShardBench [operations per thread]
+ */
+
+#include "Environment.h"
+#include "Setting.h"
+#include "Timer.h"
+#include "TimerManager.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+using namespace FreeAX25::Runtime;
+
+static void set(Environment& e, const string& key, const string& value) {
+	e.configuration.settings.erase(key);
+	e.configuration.settings.insertNew(key, new Setting(key, value));
+}
+
+static void work(atomic<bool>& go, size_t operations) {
+	vector<unique_ptr<Timer>> timers{};
+	for (size_t i = 0; i < 64; ++i) {
+		timers.emplace_back(new Timer("bench", milliseconds(1), []() {}));
+		timers.back()->start(seconds(60 + i));
+	} // end for //
+	while (!go) this_thread::yield();
+	for (size_t i = 0; i < operations; ++i)
+		timers[i % timers.size()]->restart(seconds(60 + i % 300));
+}
+
+int main(int argc, char** argv) {
+	size_t operations = (argc > 1) ? strtoul(argv[1], nullptr, 10) : 200000;
+	static Environment e{};
+	env(&e);
+	set(e, "timerBackend", "wheel");
+
+	const size_t counts[] = { 1, 2, 4, 8, 16, 32 };
+	printf("%-7s", "shards");
+	for (size_t threads : counts) printf(" %7zu thr", threads);
+	printf("   (Mops/s)\n");
+	// Shards can only grow, so go from few to many:
+	for (size_t shards : counts) {
+		set(e, "timerShards", to_string(shards));
+		e.timerManager.init();
+		e.timerManager.start();
+		printf("%-7zu", shards);
+		for (size_t threads : counts) {
+			atomic<bool> go{false};
+			vector<thread> workers{};
+			for (size_t i = 0; i < threads; ++i)
+				workers.emplace_back(work, ref(go), operations);
+			// Let the threads create their timers first:
+			this_thread::sleep_for(milliseconds(50));
+			auto t0 = steady_clock::now();
+			go = true;
+			for (auto& worker : workers) worker.join();
+			auto t1 = steady_clock::now();
+			double us = duration_cast<microseconds>(t1 - t0).count();
+			printf(" %11.2f", threads * operations / us);
+			fflush(stdout);
+		} // end for //
+		printf("\n");
+		e.timerManager.terminate();
+		e.timerManager.join();
+	} // end for //
+	return 0;
+}
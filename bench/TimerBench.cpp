@@ -0,0 +1,96 @@
+/*
+    Project FreeAX25_Runtime
+    Copyright (C) 2015  tania@df9ry.de
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/** @file */
+
+/*
+ * Benchmark of the timer backends. For every backend and number of active
+ * timers it measures restart(), as done for T1/T3 on every frame, and a
+ * stop() followed by start(). The active timers have deadlines between
+ * 100ms and 300s.
+ *
+ * Usage: TimerBench [operations]
+ */
+
+#include "Environment.h"
+#include "Setting.h"
+#include "Timer.h"
+#include "TimerManager.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+using namespace FreeAX25::Runtime;
+
+static void set(Environment& e, const string& key, const string& value) {
+	e.configuration.settings.erase(key);
+	e.configuration.settings.insertNew(key, new Setting(key, value));
+}
+
+int main(int argc, char** argv) {
+	size_t operations = (argc > 1) ? strtoul(argv[1], nullptr, 10) : 1000000;
+	static Environment e{};
+	env(&e);
+	set(e, "tick", "10");
+
+	const char* backends[] = { "multimap", "wheel" };
+	const size_t actives[] = { 100, 10000, 100000 };
+	printf("%-9s %8s %12s %12s %12s\n",
+			"backend", "active", "start ns", "restart ns", "stop+start ns");
+	for (const char* backend : backends) {
+		set(e, "timerBackend", backend);
+		e.timerManager.init();
+		e.timerManager.start();
+		for (size_t active : actives) {
+			mt19937 random(4711);
+			uniform_int_distribution<int> duration(100, 300000);
+			vector<unique_ptr<Timer>> timers{};
+			timers.reserve(active);
+			for (size_t i = 0; i < active; ++i)
+				timers.emplace_back(new Timer("bench", milliseconds(1), []() {}));
+			auto t0 = steady_clock::now();
+			for (auto& timer : timers)
+				timer->start(milliseconds(duration(random)));
+			auto t1 = steady_clock::now();
+			for (size_t i = 0; i < operations; ++i)
+				timers[i % active]->restart(milliseconds(duration(random)));
+			auto t2 = steady_clock::now();
+			for (size_t i = 0; i < operations; ++i) {
+				Timer& timer = *timers[i % active];
+				timer.stop();
+				timer.start(milliseconds(duration(random)));
+			} // end for //
+			auto t3 = steady_clock::now();
+			printf("%-9s %8zu %12.1f %12.1f %12.1f\n", backend, active,
+					duration_cast<nanoseconds>(t1 - t0).count() / (double)active,
+					duration_cast<nanoseconds>(t2 - t1).count() / (double)operations,
+					duration_cast<nanoseconds>(t3 - t2).count() / (double)operations);
+		} // end for //
+		e.timerManager.terminate();
+		e.timerManager.join();
+	} // end for //
+	return 0;
+}
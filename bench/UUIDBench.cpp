@@ -0,0 +1,92 @@
+/*
+    Project FreeAX25_Runtime
+    Copyright (C) 2015  tania@df9ry.de
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/** @file */
+
+/*
+ * Microbenchmark of the UUID generator against libuuid. Both sides create
+ * a random version 4 UUID and format it to text.
+ *
+ * Usage: UUIDBench [count]
+ */
+
+#include "UUID.h"
+#include "SessionId.h"
+
+#include <uuid/uuid.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+using namespace std;
+using namespace std::chrono;
+using namespace FreeAX25::Runtime;
+
+// Keeps the compiler from dropping the loops:
+static volatile char sink;
+
+template <typename F>
+static double nsPerCall(size_t count, F f) {
+	auto start = steady_clock::now();
+	for (size_t i = 0; i < count; ++i) f();
+	return duration<double, nano>(steady_clock::now() - start).count() / count;
+}
+
+int main(int argc, char** argv) {
+	size_t count = (argc > 1) ? strtoul(argv[1], nullptr, 10) : 1000000;
+	uint8_t uuid[UUID_SIZE];
+	char text[UUID_TEXT_LENGTH + 1];
+	uuid_t lib;
+
+	// Warm up, the first call seeds the generator of the thread:
+	newUUID(uuid);
+
+	double ours = nsPerCall(count, [&]() {
+		newUUID(uuid);
+		formatUUID(uuid, text);
+		sink = text[0];
+	});
+	double ourString = nsPerCall(count, [&]() {
+		sink = newUUID()[0];
+	});
+	double sessionId = nsPerCall(count, [&]() {
+		sink = (char)SessionId::random().lo();
+	});
+	double libuuid = nsPerCall(count, [&]() {
+		uuid_generate_random(lib);
+		uuid_unparse_lower(lib, text);
+		sink = text[0];
+	});
+	double libString = nsPerCall(count, [&]() {
+		uuid_generate_random(lib);
+		uuid_unparse_lower(lib, text);
+		sink = string(text, UUID_TEXT_LENGTH)[0];
+	});
+
+	printf("%zu UUIDs, ns per UUID:\n", count);
+	printf("  newUUID + formatUUID           %8.1f\n", ours);
+	printf("  newUUID() as string            %8.1f\n", ourString);
+	printf("  SessionId::random()            %8.1f\n", sessionId);
+	printf("  uuid_generate_random + unparse %8.1f\n", libuuid);
+	printf("  same, as string                %8.1f\n", libString);
+	printf("  speedup                        %8.1fx\n", libuuid / ours);
+	return 0;
+}